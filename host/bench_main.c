@@ -0,0 +1,191 @@
+/*
+ * Host front end for the benchmark sweep, see bench.h.
+ *
+ *   codec_bench [--json] [--repeats n] [--warmup n] [--seed n]
+ *               [--sizes n,n,...] [--codecs name,...]
+ *               [--corpora name,...] [--trace file]
+ *
+ * --codecs and --corpora narrow the sweep to the named codecs and
+ * corpora, as they are printed in the results.  --trace adds a
+ * recorded trace, one reading per line, to the corpora.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "corpus.h"
+
+#define MAX_SIZES   32
+
+/*
+ * Reads a whole decimal number of at least min, returns 0 or -1 if the
+ * text is not one.
+ */
+static int ParseNumber(const char *text, long min, long *value)
+{
+    char *end;
+
+    *value = strtol(text, &end, 10);
+
+    return ((end == text) || (*end != '\0') || (*value < min)) ? -1 : 0;
+}
+
+/*
+ * Reads a comma separated list of positive sizes, returns the count or
+ * -1 if the text is not one.
+ */
+static int ParseSizes(const char *text, long *sizes)
+{
+    char *end;
+    int count = 0;
+
+    for (;;)
+    {
+        if (count == MAX_SIZES)
+        {
+            return -1;
+        }
+
+        sizes[count] = strtol(text, &end, 10);
+
+        if ((end == text) || (sizes[count] <= 0))
+        {
+            return -1;
+        }
+
+        count++;
+
+        if (*end == '\0')
+        {
+            return count;
+        }
+
+        if (*end != ',')
+        {
+            return -1;
+        }
+
+        text = end + 1;
+    }
+}
+
+/*
+ * Reads a comma separated list of names into a mask with a bit for the
+ * index of each, as named by name().  Returns 0, or -1 if a name is not
+ * one of the count there are.
+ */
+static int ParseNames(const char *text, int count, const char *(*name)(int),
+    unsigned *mask)
+{
+    size_t length;
+    int i;
+
+    *mask = 0;
+
+    for (;;)
+    {
+        length = strcspn(text, ",");
+
+        for (i = 0; i < count; i++)
+        {
+            if ((strlen(name(i)) == length) &&
+                (strncmp(text, name(i), length) == 0))
+            {
+                break;
+            }
+        }
+
+        if (i == count)
+        {
+            return -1;
+        }
+
+        *mask |= 1U << i;
+
+        if (text[length] == '\0')
+        {
+            return 0;
+        }
+
+        text += length + 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_config_t config;
+    long sizes[MAX_SIZES];
+    long value;
+    char *p;
+    char *end;
+    int i;
+
+    BenchDefaults(&config);
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            config.output = BENCH_JSON;
+        }
+        else if ((strcmp(argv[i], "--repeats") == 0) && (i + 1 < argc) &&
+            (ParseNumber(argv[++i], 1, &value) == 0))
+        {
+            config.repeats = (int)value;
+        }
+        else if ((strcmp(argv[i], "--warmup") == 0) && (i + 1 < argc) &&
+            (ParseNumber(argv[++i], 0, &value) == 0))
+        {
+            config.warmup = (int)value;
+        }
+        else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc))
+        {
+            p = argv[++i];
+            config.seed = strtoull(p, &end, 0);
+
+            if ((end == p) || (*end != '\0'))
+            {
+                break;
+            }
+        }
+        else if ((strcmp(argv[i], "--codecs") == 0) && (i + 1 < argc))
+        {
+            if (ParseNames(argv[++i], BENCH_CODECS, BenchCodecName,
+                &config.codecs) != 0)
+            {
+                break;
+            }
+        }
+        else if ((strcmp(argv[i], "--corpora") == 0) && (i + 1 < argc))
+        {
+            if (ParseNames(argv[++i], CORPUS_TRACE + 1, CorpusName,
+                &config.corpora) != 0)
+            {
+                break;
+            }
+        }
+        else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+        {
+            config.trace = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--sizes") == 0) && (i + 1 < argc) &&
+            ((config.sizeCount = ParseSizes(argv[++i], sizes)) > 0))
+        {
+            config.sizes = sizes;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (i < argc)
+    {
+        fprintf(stderr, "usage: %s [--json] [--repeats n] [--warmup n] "
+            "[--seed n] [--sizes n,n,...] [--codecs name,...] "
+            "[--corpora name,...] [--trace file]\n", argv[0]);
+        return 2;
+    }
+
+    return (BenchRun(&config) == 0) ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+/*
+ * Host entry point.  On the ESP32 the IDF startup code calls
+ * app_main(); here it is called from main().
+ */
+void app_main(void);
+
+int main(void)
+{
+    app_main();
+    return 0;
+}
@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the ESP-IDF header of the same name, so main.c
+ * builds unchanged.  See port.h.
+ */
+#ifndef _SHIM_ESP_SYSTEM_H_
+#define _SHIM_ESP_SYSTEM_H_
+
+#include "port.h"
+
+typedef int esp_err_t;
+
+#define esp_random()                PortRandom()
+#define esp_get_free_heap_size()    PortFreeHeap()
+
+#endif  /* ndef _SHIM_ESP_SYSTEM_H_ */
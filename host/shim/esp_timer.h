@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for the ESP-IDF header of the same name, so main.c
+ * builds unchanged.  See port.h.
+ */
+#ifndef _SHIM_ESP_TIMER_H_
+#define _SHIM_ESP_TIMER_H_
+
+#include "port.h"
+
+#define esp_timer_get_time()    PortTimeUs()
+
+#endif  /* ndef _SHIM_ESP_TIMER_H_ */
@@ -0,0 +1,10 @@
+/*
+ * Host stand-in for the FreeRTOS header of the same name, so main.c
+ * builds unchanged.
+ */
+#ifndef _SHIM_FREERTOS_H_
+#define _SHIM_FREERTOS_H_
+
+#define portTICK_PERIOD_MS  1
+
+#endif  /* ndef _SHIM_FREERTOS_H_ */
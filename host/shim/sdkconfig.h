@@ -0,0 +1,4 @@
+/*
+ * Host stand-in for the ESP-IDF header of the same name.  Nothing in
+ * it is used off the device.
+ */
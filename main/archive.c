@@ -0,0 +1,360 @@
+/***************************************************************************
+*                        Seekable Sample Archives
+*
+*   File    : archive.c
+*   Purpose : Writes and reads indexed archives of fixed format samples.
+*             Smaller blocks make range reads cheaper but give the
+*             adaptive models less data to learn from and add a header
+*             per block, so blockSamples trades ratio for access time.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include "archive.h"
+#include "container.h"
+#include "crc32.h"
+#include "memtrack.h"
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : StoreLE32 / LoadLE32
+*   Description: Write and read the little endian index fields.
+***************************************************************************/
+static void StoreLE32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t LoadLE32(const uint8_t *p)
+{
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/***************************************************************************
+*   Function   : ArchiveBound
+*   Description: Worst case size of an archive: every block stored, plus
+*                the block headers, the index and the footer.
+*   Parameters : length - number of chars of text
+*                format - CONTAINER_FORMAT() of the samples
+*                blockSamples - samples per block
+*   Returned   : Bytes needed for the output buffer, -1 for bad arguments
+***************************************************************************/
+long ArchiveBound(long length, int format, long blockSamples)
+{
+    long samples;
+    long blocks;
+
+    if ((format == 0) || (blockSamples < 1) || (length < 0))
+    {
+        return -1;
+    }
+
+    samples = length / CONTAINER_SAMPLE_LENGTH(format);
+    blocks = (samples + blockSamples - 1) / blockSamples;
+
+    return length + blocks * (CONTAINER_HEADER_SIZE + ARCHIVE_ENTRY_SIZE) +
+        ARCHIVE_FOOTER_SIZE;
+}
+
+/***************************************************************************
+*   Function   : ArchiveWrite
+*   Description: This routine cuts the samples into blocks and codes
+*                each one as an independent container block, then appends
+*                the index and footer.
+*   Parameters : codec - the CODEC_ id to code the blocks with
+*                flags - container flags, see ContainerEncode
+*                format - CONTAINER_FORMAT() of the samples
+*                text - the samples, a whole number of them
+*                length - number of chars of text
+*                blockSamples - samples per block
+*                out - where the archive goes
+*                capacity - size of out, ArchiveBound() is enough
+*   Effects    : The archive is written to out
+*   Returned   : Size of the archive in bytes, -1 for failure.
+***************************************************************************/
+long ArchiveWrite(int codec, int flags, int format, const char *text,
+    long length, long blockSamples, uint8_t *out, long capacity)
+{
+    long sampleLength;
+    long samples;
+    long blocks;
+    long block;
+    long blockLen;
+    long outLen;
+    long written;
+    uint8_t *entry;
+
+    if ((NULL == text) || (NULL == out) || (format == 0) ||
+        (blockSamples < 1) || (length < 0))
+    {
+        return -1;
+    }
+
+    sampleLength = CONTAINER_SAMPLE_LENGTH(format);
+
+    if ((length % sampleLength) != 0)
+    {
+        return -1;
+    }
+
+    samples = length / sampleLength;
+    blocks = (samples + blockSamples - 1) / blockSamples;
+
+    /* the index is built at the end of out and moved down once the
+     * blocks are written */
+    if (capacity < blocks * ARCHIVE_ENTRY_SIZE + ARCHIVE_FOOTER_SIZE)
+    {
+        return -1;
+    }
+
+    capacity -= blocks * ARCHIVE_ENTRY_SIZE + ARCHIVE_FOOTER_SIZE;
+    entry = out + capacity;
+    outLen = 0;
+
+    for (block = 0; block < blocks; block++)
+    {
+        blockLen = blockSamples * sampleLength;
+
+        if (blockLen > length - block * blockSamples * sampleLength)
+        {
+            blockLen = length - block * blockSamples * sampleLength;
+        }
+
+        StoreLE32(entry + block * ARCHIVE_ENTRY_SIZE,
+            (uint32_t)(block * blockSamples));
+        StoreLE32(entry + block * ARCHIVE_ENTRY_SIZE + 4, (uint32_t)outLen);
+
+        written = ContainerEncode(codec, flags, format,
+            text + block * blockSamples * sampleLength, blockLen,
+            out + outLen, capacity - outLen);
+
+        if (written < 0)
+        {
+            return -1;
+        }
+
+        outLen += written;
+    }
+
+    memmove(out + outLen, entry, blocks * ARCHIVE_ENTRY_SIZE);
+    entry = out + outLen + blocks * ARCHIVE_ENTRY_SIZE;
+
+    StoreLE32(entry, (uint32_t)outLen);
+    StoreLE32(entry + 4, (uint32_t)blocks);
+    StoreLE32(entry + 8, (uint32_t)samples);
+    StoreLE32(entry + 12, (uint32_t)blockSamples);
+    entry[16] = (uint8_t)format;
+    entry[17] = entry[18] = entry[19] = 0;
+    StoreLE32(entry + 20, Crc32(0, out + outLen,
+        blocks * ARCHIVE_ENTRY_SIZE + 20));
+    StoreLE32(entry + 24, ARCHIVE_MAGIC);
+
+    return outLen + blocks * ARCHIVE_ENTRY_SIZE + ARCHIVE_FOOTER_SIZE;
+}
+
+/***************************************************************************
+*   Function   : ArchiveOpen
+*   Description: This routine finds the index through the footer at the
+*                end of an archive and checks it.  The blocks themselves
+*                are only checked as they are read.
+*   Parameters : in - the archive
+*                length - size of the archive in bytes
+*                archive - where the archive description goes
+*   Effects    : archive is filled in
+*   Returned   : 0 if the archive can be read, -1 otherwise.
+***************************************************************************/
+int ArchiveOpen(const uint8_t *in, long length, archive_t *archive)
+{
+    const uint8_t *footer;
+    uint32_t indexOffset;
+    uint32_t blocks;
+    uint32_t samples;
+    uint32_t blockSamples;
+
+    if ((NULL == in) || (length < ARCHIVE_FOOTER_SIZE))
+    {
+        return -1;
+    }
+
+    footer = in + length - ARCHIVE_FOOTER_SIZE;
+    indexOffset = LoadLE32(footer);
+    blocks = LoadLE32(footer + 4);
+    samples = LoadLE32(footer + 8);
+    blockSamples = LoadLE32(footer + 12);
+
+    if ((LoadLE32(footer + 24) != ARCHIVE_MAGIC) ||
+        (footer[16] == 0) || (blockSamples == 0) ||
+        (blocks > (uint32_t)(length - ARCHIVE_FOOTER_SIZE) /
+            ARCHIVE_ENTRY_SIZE) ||
+        (indexOffset != (uint32_t)(length - ARCHIVE_FOOTER_SIZE) -
+            blocks * ARCHIVE_ENTRY_SIZE) ||
+        (samples > (uint64_t)blocks * blockSamples) ||
+        (Crc32(0, in + indexOffset, blocks * ARCHIVE_ENTRY_SIZE + 20) !=
+            LoadLE32(footer + 20)))
+    {
+        return -1;
+    }
+
+    archive->data = in;
+    archive->index = in + indexOffset;
+    archive->blockCount = blocks;
+    archive->sampleCount = samples;
+    archive->blockSamples = blockSamples;
+    archive->format = footer[16];
+    archive->sampleLength = CONTAINER_SAMPLE_LENGTH(footer[16]);
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FindBlock
+*   Description: Binary search of the index for the block holding sample.
+*   Returned   : The block number
+***************************************************************************/
+static long FindBlock(const archive_t *archive, long sample)
+{
+    long low = 0;
+    long high = archive->blockCount - 1;
+    long mid;
+
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+
+        if (LoadLE32(archive->index + mid * ARCHIVE_ENTRY_SIZE) <=
+            (uint32_t)sample)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+
+    return low;
+}
+
+/***************************************************************************
+*   Function   : ArchiveRead
+*   Description: This routine decodes a range of samples.  Only the
+*                blocks covering the range are decoded.  Blocks wholly
+*                inside the range are decoded straight into out, the
+*                partly covered ones at the ends go through a block sized
+*                buffer.
+*   Parameters : archive - an archive opened with ArchiveOpen
+*                first - number of the first sample wanted
+*                last - number of the sample after the last one wanted
+*                out - where the samples go
+*                capacity - size of out in bytes
+*   Effects    : The samples are written to out, '\0' terminated when
+*                there is room.
+*   Returned   : Number of chars written, -1 if the range is not in the
+*                archive, a block is corrupt or out is too small.
+***************************************************************************/
+long ArchiveRead(const archive_t *archive, long first, long last,
+    char *out, long capacity)
+{
+    const uint8_t *entry;
+    char *scratch = NULL;
+    long indexOffset;
+    long block;
+    long blockFirst;
+    long blockLast;
+    long blockLen;
+    long offset;
+    long from;
+    long to;
+    long outLen = 0;
+
+    if ((NULL == out) || (first < 0) || (first > last) ||
+        (last > archive->sampleCount) ||
+        ((last - first) * archive->sampleLength > capacity))
+    {
+        return -1;
+    }
+
+    indexOffset = archive->index - archive->data;
+    block = (first < last) ? FindBlock(archive, first) : archive->blockCount;
+
+    for (; block < archive->blockCount; block++)
+    {
+        entry = archive->index + block * ARCHIVE_ENTRY_SIZE;
+        blockFirst = LoadLE32(entry);
+        offset = LoadLE32(entry + 4);
+        blockLast = (block + 1 < archive->blockCount) ?
+            (long)LoadLE32(entry + ARCHIVE_ENTRY_SIZE) : archive->sampleCount;
+
+        if (blockFirst >= last)
+        {
+            break;
+        }
+
+        if ((offset >= indexOffset) || (blockLast < blockFirst) ||
+            (blockLast - blockFirst > archive->blockSamples))
+        {
+            outLen = -1;
+            break;
+        }
+
+        blockLen = (blockLast - blockFirst) * archive->sampleLength;
+        from = (first > blockFirst) ? first : blockFirst;
+        to = (last < blockLast) ? last : blockLast;
+
+        if ((from == blockFirst) && (to == blockLast))
+        {
+            if (ContainerDecode(archive->data + offset, indexOffset - offset,
+                out + outLen, capacity - outLen) != blockLen)
+            {
+                outLen = -1;
+                break;
+            }
+        }
+        else
+        {
+            if (NULL == scratch)
+            {
+                scratch = MemAlloc(archive->blockSamples *
+                    archive->sampleLength + 1);
+
+                if (NULL == scratch)
+                {
+                    outLen = -1;
+                    break;
+                }
+            }
+
+            if (ContainerDecode(archive->data + offset, indexOffset - offset,
+                scratch, blockLen + 1) != blockLen)
+            {
+                outLen = -1;
+                break;
+            }
+
+            memcpy(out + outLen,
+                scratch + (from - blockFirst) * archive->sampleLength,
+                (to - from) * archive->sampleLength);
+        }
+
+        outLen += (to - from) * archive->sampleLength;
+    }
+
+    MemFree(scratch);
+
+    if ((outLen >= 0) && (outLen < capacity))
+    {
+        out[outLen] = '\0';
+    }
+
+    return outLen;
+}
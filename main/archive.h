@@ -0,0 +1,69 @@
+/***************************************************************************
+*                        Seekable Sample Archives
+*
+*   File    : archive.h
+*   Purpose : Provides the layout and prototypes of indexed archives.
+*             The samples are cut into blocks of a fixed number of
+*             samples and every block is coded on its own as a container
+*             block, so any range of samples can be decoded from just the
+*             blocks that cover it.  The blocks are followed by an index
+*             and a fixed size footer:
+*
+*               blocks     ARCHIVE_ENTRY_SIZE bytes per block, the number
+*                          of its first sample and its byte offset, both
+*                          4 bytes little endian
+*               footer     byte offset of the index, number of blocks,
+*                          number of samples, samples per block, 4 bytes
+*                          each, the sample format and 3 zero bytes, the
+*                          CRC-32 of the index and the footer up to here,
+*                          then ARCHIVE_MAGIC
+*
+***************************************************************************/
+
+#ifndef _ARCHIVE_H_
+#define _ARCHIVE_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define ARCHIVE_ENTRY_SIZE      8
+#define ARCHIVE_FOOTER_SIZE     28
+#define ARCHIVE_MAGIC           0x58524153UL    /* "SARX" little endian */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    const uint8_t *data;        /* the whole archive */
+    const uint8_t *index;       /* first index entry */
+    long blockCount;            /* number of blocks */
+    long sampleCount;           /* number of samples */
+    long blockSamples;          /* samples per block, the last may be short */
+    int format;                 /* CONTAINER_FORMAT() of the samples */
+    int sampleLength;           /* chars per sample */
+} archive_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* largest archive ArchiveWrite can produce */
+long ArchiveBound(long length, int format, long blockSamples);
+
+/* code text in blocks of blockSamples, returns the archive size or -1 */
+long ArchiveWrite(int codec, int flags, int format, const char *text,
+    long length, long blockSamples, uint8_t *out, long capacity);
+
+/* check an archive's footer and index, returns 0 if usable or -1 */
+int ArchiveOpen(const uint8_t *in, long length, archive_t *archive);
+
+/* decode samples [first, last), returns the chars written or -1 */
+long ArchiveRead(const archive_t *archive, long first, long last,
+    char *out, long capacity);
+
+#endif  /* ndef _ARCHIVE_H_ */
@@ -40,61 +40,139 @@
 #include "arith_coder.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "bitio.h"
-#include "lzw.h"
-
-/*
- * These four variables define the current state of the arithmetic
- * coder/decoder.  They are assumed to be 16 bits long.  Note that
- * by declaring them as short ints, they will actually be 16 bits
- * on most 80X86 and 680X0 machines, as well as VAXen.
- */
-static unsigned short int code;  /* The present input code value       */
-static unsigned short int low;   /* Start of the current code range    */
-static unsigned short int high;  /* End of the current code range      */
-long underflow_bits;             /* Number of underflow bits pending   */
-
-distribution probabilities_encoder[]= {{ '0',  0,  1  },
-									   { '1',  1,  2  },
-									   { '2',  2,  3  },
-									   { '3',  3,  4  },
-									   { '4',  4,  5  },
-									   { '5',  5,  6  },
-									   { '6',  6,  7  },
-									   { '7',  7,  8  },
-									   { '8',  8,  9 },
-									   { '9',  9,  10 },
-									   { '.',  10,  11 },
-									   { '\0', 11, 12  }
-									   };
-distribution probabilities_decoder[]= {{ '0',  0,  1  },
-									   { '1',  1,  2  },
-									   { '2',  2,  3  },
-									   { '3',  3,  4  },
-									   { '4',  4,  5  },
-									   { '5',  5,  6  },
-									   { '6',  6,  7  },
-									   { '7',  7,  8  },
-									   { '8',  8,  9 },
-									   { '9',  9,  10 },
-									   { '.',  10,  11 },
-									   { '\0', 11, 12  }
-									   };
-
-unsigned int encode_distribution_size = sizeof(probabilities_encoder)/sizeof(probabilities_encoder[0]);
-unsigned int decode_distribution_size = sizeof(probabilities_decoder)/sizeof(probabilities_decoder[0]);
-uint8_t stop = 0;
+#include "memtrack.h"
+#include "profile.h"
+
+/*
+ * The characters of the symbol set, in model order, and the model
+ * index + 1 of every character, 0 for the ones not in the set.  Both
+ * are built from the alphabet in schema.h, with the '\0' terminator
+ * as the last symbol.  The model itself only deals with indexes.
+ */
+#define TERMINATOR      SCHEMA_SYMBOLS
+
+static const uint8_t symbol_index[ 256 ] = {
+                                       SCHEMA_ALPHABET( SCHEMA_SYMBOL_ENTRY )
+                                       [ 0 ] = TERMINATOR + 1
+                                       };
+
+static const char symbol_chars[ SYMBOL_COUNT ] = {
+                                       SCHEMA_ALPHABET( SCHEMA_CHAR_ENTRY )
+                                       [ TERMINATOR ] = '\0'
+                                       };
+
+/*
+ * The model is reset to the flat starting distribution.  This has
+ * to be done identically at both ends of the stream.
+ */
+void initialize_model( arith_ctx *ctx )
+{
+    model_init( &ctx->model, SYMBOL_COUNT,
+                ctx->engine == ARITH_ENGINE_RANGE32 ?
+                RANGE_MAXIMUM_SCALE : MAXIMUM_SCALE );
+    ctx->models = NULL;
+    ctx->bytes = NULL;
+    ctx->current = &ctx->model;
+    ctx->context = ARITH_CONTEXT_ORDER0;
+    ctx->sample_length = 1;
+    ctx->position = 0;
+    ctx->stop = 0;
+}
+
+/*
+ * The number of models a context mode needs for a sample length.
+ */
+int arith_context_models( int context, int sample_length )
+{
+    if ( context == ARITH_CONTEXT_POSITION )
+        return( sample_length );
+    if ( context == ARITH_CONTEXT_POS_PREV )
+        return( sample_length * SYMBOL_COUNT );
+    return( 0 );
+}
+
+/*
+ * Switches a freshly started encoder or decoder to a positional
+ * context mode.  The caller provides arith_context_models() models,
+ * which must outlive the context.  Both ends of a stream have to
+ * make the same call before the first character.  Returns -1 if the
+ * mode cannot be used.
+ */
+int arith_set_context( arith_ctx *ctx, int context, int sample_length,
+                       FREQ_MODEL *models )
+{
+    int i;
+    int count;
+
+    if ( context == ARITH_CONTEXT_ORDER0 )
+        return( 0 );
+    if ( sample_length < 1 || sample_length > ARITH_MAX_POSITIONS ||
+         models == NULL )
+        return( -1 );
+    count = arith_context_models( context, sample_length );
+    for ( i = 0 ; i < count ; i++ )
+        model_init( &models[ i ], SYMBOL_COUNT, ctx->model.limit );
+    for ( i = 0 ; i < sample_length ; i++ )
+        ctx->prev[ i ] = 0;
+    ctx->models = models;
+    ctx->context = context;
+    ctx->sample_length = sample_length;
+    ctx->position = 0;
+    ctx->current = &models[ 0 ];
+    return( 0 );
+}
+
+/*
+ * Once a character has been coded, its model is updated and the
+ * model for the next position is picked.
+ */
+static void next_context( arith_ctx *ctx, int index )
+{
+    model_update( ctx->current, index );
+    if ( ctx->context == ARITH_CONTEXT_ORDER0 )
+        return;
+    ctx->prev[ ctx->position ] = (uint8_t) index;
+    if ( ++ctx->position == ctx->sample_length )
+        ctx->position = 0;
+    if ( ctx->context == ARITH_CONTEXT_POSITION )
+        ctx->current = &ctx->models[ ctx->position ];
+    else
+        ctx->current = &ctx->models[ ctx->position * SYMBOL_COUNT +
+                                     ctx->prev[ ctx->position ] ];
+}
+
 /*
  * This routine must be called to initialize the encoding process.
  * The high register is initialized to all 1s, and it is assumed that
  * it has an infinite string of 1s to be shifted into the lower bit
  * positions when needed.
  */
-void initialize_arithmetic_encoder()
+void initialize_arithmetic_encoder( arith_ctx *ctx )
+{
+    ctx->low = 0;
+    ctx->high = 0xffff;
+    ctx->underflow_bits = 0;
+}
+
+/*
+ * The pending underflow bits are all the same, so they are shipped
+ * out up to 32 at a time.
+ */
+static void output_underflow_bits( arith_ctx *ctx, int bit )
 {
-    low = 0;
-    high = 0xffff;
-    underflow_bits = 0;
+    int n;
+    PROFILE_START( start );
+
+    PROFILE_COUNT( PROFILE_BITS_OUT, ctx->underflow_bits );
+    while ( ctx->underflow_bits > 0 )
+    {
+        n = ctx->underflow_bits > 32 ? 32 : (int) ctx->underflow_bits;
+        put_bits( &ctx->bits, n, bit ? 0xffffffffUL : 0 );
+        ctx->underflow_bits -= n;
+    }
+    PROFILE_STOP( PROFILE_UNDERFLOW, start );
 }
 
 /*
@@ -107,9 +185,12 @@ void initialize_arithmetic_encoder()
  * the output stream.  Finally, high and low are stable again and
  * the routine returns.
  */
-void encode_symbol( uint16_t *stream, SYMBOL *s )
+void encode_symbol( arith_ctx *ctx, SYMBOL *s )
 {
     long range;
+    unsigned short int low = ctx->low;
+    unsigned short int high = ctx->high;
+    PROFILE_START( start );
 /*
  * These three lines rescale high and low for the new symbol.
  */
@@ -118,6 +199,8 @@ void encode_symbol( uint16_t *stream, SYMBOL *s )
                  (( range * s->high_count ) / s->scale - 1 );
     low = low + (unsigned short int )
                  (( range * s->low_count ) / s->scale );
+    PROFILE_STOP( PROFILE_RESCALE, start );
+    PROFILE_START( renorm );
 /*
  * This loop turns out new bits until high and low are far enough
  * apart to have stabilized.
@@ -130,12 +213,10 @@ void encode_symbol( uint16_t *stream, SYMBOL *s )
  */
         if ( ( high & 0x8000 ) == ( low & 0x8000 ) )
         {
-            output_bit( stream, high & 0x8000 );
-            while ( underflow_bits > 0 )
-            {
-                output_bit( stream, ~high & 0x8000 );
-                underflow_bits--;
-            }
+            output_bit( &ctx->bits, high & 0x8000 );
+            PROFILE_COUNT( PROFILE_BITS_OUT, 1 );
+            if ( ctx->underflow_bits > 0 )
+                output_underflow_bits( ctx, ~high & 0x8000 );
         }
 /*
  * If this test passes, the numbers are in danger of underflow, because
@@ -143,29 +224,38 @@ void encode_symbol( uint16_t *stream, SYMBOL *s )
  */
         else if ( ( low & 0x4000 ) && !( high & 0x4000 ))
         {
-            underflow_bits += 1;
+            ctx->underflow_bits += 1;
+            PROFILE_COUNT( PROFILE_UNDERFLOWS, 1 );
             low &= 0x3fff;
             high |= 0x4000;
         }
         else
-            return ;
+            break;
         low <<= 1;
         high <<= 1;
         high |= 1;
     }
+    PROFILE_STOP( PROFILE_RENORM, renorm );
+    ctx->low = low;
+    ctx->high = high;
 }
 
 /*
  * At the end of the encoding process, there are still significant
  * bits left in the high and low registers.  We output two bits,
- * plus as many underflow bits as are necessary.
+ * plus as many underflow bits as are necessary.  These are timed as
+ * renormalization, so the underflow bits nest in it as they do in
+ * encode_symbol().
  */
-void flush_arithmetic_encoder( uint16_t *stream )
+void flush_arithmetic_encoder( arith_ctx *ctx )
 {
-    output_bit( stream, low & 0x4000 );
-    underflow_bits++;
-    while ( underflow_bits-- > 0 )
-        output_bit( stream, ~low & 0x4000 );
+    PROFILE_START( renorm );
+
+    output_bit( &ctx->bits, ctx->low & 0x4000 );
+    PROFILE_COUNT( PROFILE_BITS_OUT, 1 );
+    ctx->underflow_bits++;
+    output_underflow_bits( ctx, ~ctx->low & 0x4000 );
+    PROFILE_STOP( PROFILE_RENORM, renorm );
 }
 
 /*
@@ -176,16 +266,14 @@ void flush_arithmetic_encoder( uint16_t *stream )
  *
  *  code = count / s->scale
  */
-unsigned short int get_current_count( SYMBOL *s )
+unsigned short int get_current_count( arith_ctx *ctx, SYMBOL *s )
 {
     long range;
     unsigned short int count;
 
-    range = (long) ( high - low ) + 1;
+    range = (long) ( ctx->high - ctx->low ) + 1;
     count = (short int)
-            ((((long) ( code - low ) + 1 ) * s->scale-1 ) / range );
-    //printf("\n( %u - %u ) + 1 ) * %u - 1 ) / %lu = %i\n",code, low, s->scale, range, count);
-    //print_distribution();
+            ((((long) ( ctx->code - ctx->low ) + 1 ) * s->scale-1 ) / range );
     return( count );
 }
 
@@ -195,18 +283,11 @@ unsigned short int get_current_count( SYMBOL *s )
  * to their conventional starting values, plus reading the first
  * 16 bits from the input stream into the code value.
  */
-void initialize_arithmetic_decoder( uint16_t *stream )
+void initialize_arithmetic_decoder( arith_ctx *ctx )
 {
-    int i;
-
-    code = 0;
-    for ( i = 0 ; i < 16 ; i++ )
-    {
-        code <<= 1;
-        code += input_bit( stream );
-    }
-    low = 0;
-    high = 0xffff;
+    ctx->code = (unsigned short int) get_bits( &ctx->bits, 16 );
+    ctx->low = 0;
+    ctx->high = 0xffff;
 }
 
 /*
@@ -215,9 +296,13 @@ void initialize_arithmetic_decoder( uint16_t *stream )
  * decoded, this routine has to be called to remove it from the
  * input stream.
  */
-void remove_symbol_from_stream( uint16_t *stream, SYMBOL *s )
+void remove_symbol_from_stream( arith_ctx *ctx, SYMBOL *s )
 {
     long range;
+    unsigned short int code = ctx->code;
+    unsigned short int low = ctx->low;
+    unsigned short int high = ctx->high;
+    PROFILE_START( start );
 
 /*
  * First, the range is expanded to account for the symbol removal.
@@ -251,13 +336,257 @@ void remove_symbol_from_stream( uint16_t *stream, SYMBOL *s )
  * Otherwise, nothing can be shifted out, so I return.
  */
         else
-            return;
+            break;
         low <<= 1;
         high <<= 1;
         high |= 1;
         code <<= 1;
-        code += input_bit( stream );
+        code += input_bit( &ctx->bits );
     }
+    ctx->code = code;
+    ctx->low = low;
+    ctx->high = high;
+    PROFILE_STOP( PROFILE_DECODE, start );
+}
+
+/*
+ * The context API.  An encoder context is set up with the buffer it
+ * writes to and the engine to run, fed one character at a time, and
+ * flushed at the end.  The flush returns the number of bytes written,
+ * or -1 if they did not fit.
+ */
+void arith_encoder_init( arith_ctx *ctx, uint8_t *stream, long capacity,
+                         int engine )
+{
+    initialize_output_bitstream( &ctx->bits, stream, capacity );
+    arith_encoder_start( ctx, engine );
+}
+
+void arith_encoder_start( arith_ctx *ctx, int engine )
+{
+    ctx->engine = engine;
+    initialize_model( ctx );
+    if ( engine == ARITH_ENGINE_RANGE32 )
+        range_encoder_init( &ctx->rc );
+    else
+        initialize_arithmetic_encoder( ctx );
+}
+
+static void code_symbol( arith_ctx *ctx, SYMBOL *s )
+{
+    if ( ctx->engine == ARITH_ENGINE_RANGE32 )
+        range_encode_symbol( &ctx->rc, &ctx->bits, s );
+    else
+        encode_symbol( ctx, s );
+}
+
+void arith_encode( arith_ctx *ctx, char c )
+{
+    SYMBOL s;
+
+    convert_int_to_symbol( ctx, c, &s );
+    if ( ctx->stop )
+        return;
+    code_symbol( ctx, &s );
+}
+
+long arith_encoder_flush( arith_ctx *ctx )
+{
+    if ( ctx->engine == ARITH_ENGINE_RANGE32 )
+        range_encoder_flush( &ctx->rc, &ctx->bits );
+    else
+        flush_arithmetic_encoder( ctx );
+    return( flush_output_bitstream( &ctx->bits ) );
+}
+
+/*
+ * A decoder context reads from a stream of a known length.  Each call
+ * to arith_decode() returns the next character, or DONE once the end
+ * of stream character has been seen or an error was detected.
+ */
+void arith_decoder_init( arith_ctx *ctx, const uint8_t *stream, long length,
+                         int engine )
+{
+    initialize_input_bitstream( &ctx->bits, stream, length );
+    arith_decoder_start( ctx, engine );
+}
+
+void arith_decoder_start( arith_ctx *ctx, int engine )
+{
+    ctx->engine = engine;
+    initialize_model( ctx );
+    if ( engine == ARITH_ENGINE_RANGE32 )
+        range_decoder_init( &ctx->rc, &ctx->bits );
+    else
+        initialize_arithmetic_decoder( ctx );
+}
+
+static unsigned int current_count( arith_ctx *ctx, SYMBOL *s )
+{
+    if ( ctx->engine == ARITH_ENGINE_RANGE32 )
+        return( range_get_current_count( &ctx->rc, s ) );
+    return( get_current_count( ctx, s ) );
+}
+
+static void remove_symbol( arith_ctx *ctx, SYMBOL *s )
+{
+    if ( ctx->engine == ARITH_ENGINE_RANGE32 )
+        range_remove_symbol( &ctx->rc, &ctx->bits, s );
+    else
+        remove_symbol_from_stream( ctx, s );
+    if ( ctx->bits.error )
+        error_exit( ctx, "Read past the end of the stream" );
+}
+
+int arith_decode( arith_ctx *ctx )
+{
+    SYMBOL s;
+    char c;
+    unsigned int count;
+
+    if ( ctx->stop )
+        return( DONE );
+    s.scale = ctx->current->total;
+    count = current_count( ctx, &s );
+    c = convert_symbol_to_int( ctx, count, &s );
+    if ( ctx->stop || c == '\0' )
+        return( DONE );
+    remove_symbol( ctx, &s );
+    return( (unsigned char) c );
+}
+
+/*
+ * Byte mode.  Any byte can be coded, and the stream ends with an
+ * END_OF_STREAM symbol rather than a '\0'.  The byte model starts out
+ * holding nothing but the ESCAPE symbol.  A symbol the model has not
+ * seen yet is sent as an ESCAPE followed by the symbol itself on a
+ * flat scale of every byte and the end of stream, and from then on
+ * it has a count of its own.  So the model only ever spends range on
+ * symbols that turned up, and a stream of digits costs much the same
+ * as with the digit model.  Each escape bumps the ESCAPE count as
+ * well, so it stays likely while new symbols keep arriving.  The flat
+ * scale uses ESCAPE's slot for the end of stream.
+ */
+#define FLAT_SCALE      ( ESCAPE + 1 )
+
+int arith_set_byte_model( arith_ctx *ctx, BYTE_MODEL *model )
+{
+    if ( model == NULL )
+        return( -1 );
+    byte_model_init( model, ctx->model.limit );
+    byte_model_update( model, ESCAPE );
+    ctx->bytes = model;
+    return( 0 );
+}
+
+void arith_encode_byte( arith_ctx *ctx, int symbol )
+{
+    SYMBOL s;
+
+    if ( ctx->stop )
+        return;
+    if ( ctx->bytes->freq[ symbol ] == 0 )
+    {
+        byte_model_get_symbol( ctx->bytes, ESCAPE, &s );
+        code_symbol( ctx, &s );
+        s.low_count = symbol == END_OF_STREAM ? ESCAPE : symbol;
+        s.high_count = s.low_count + 1;
+        s.scale = FLAT_SCALE;
+        code_symbol( ctx, &s );
+        byte_model_update( ctx->bytes, ESCAPE );
+    }
+    else
+    {
+        byte_model_get_symbol( ctx->bytes, symbol, &s );
+        code_symbol( ctx, &s );
+    }
+    byte_model_update( ctx->bytes, symbol );
+}
+
+int arith_decode_byte( arith_ctx *ctx )
+{
+    SYMBOL s;
+    unsigned int count;
+    int symbol;
+
+    if ( ctx->stop )
+        return( DONE );
+    s.scale = ctx->bytes->total;
+    count = current_count( ctx, &s );
+    if ( count >= s.scale )
+    {
+        error_exit( ctx, "Failure to decode byte" );
+        return( DONE );
+    }
+    symbol = byte_model_find_symbol( ctx->bytes, count, &s );
+    remove_symbol( ctx, &s );
+    if ( symbol == ESCAPE )
+    {
+        s.scale = FLAT_SCALE;
+        count = current_count( ctx, &s );
+        if ( count >= FLAT_SCALE )
+        {
+            error_exit( ctx, "Failure to decode byte" );
+            return( DONE );
+        }
+        s.low_count = count;
+        s.high_count = count + 1;
+        remove_symbol( ctx, &s );
+        byte_model_update( ctx->bytes, ESCAPE );
+        symbol = count == ESCAPE ? END_OF_STREAM : (int) count;
+    }
+    byte_model_update( ctx->bytes, symbol );
+    if ( ctx->stop || symbol == END_OF_STREAM )
+        return( DONE );
+    return( symbol );
+}
+
+/*
+ * compress() and expand() run ARITH_DEFAULT_CONTEXT when they are
+ * given a sample length.  The positional models are too big for an
+ * ESP32 task stack, so they live in a workspace: the caller's for
+ * compress_ws() and expand_ws(), the heap for compress() and
+ * expand().  This is the number of bytes it takes, 0 when samples
+ * are too long for the positional contexts, or there are none, and
+ * the order-0 model is used.
+ */
+long arith_workspace_size( int sample_length )
+{
+    if ( sample_length < 1 || sample_length > ARITH_MAX_POSITIONS )
+        return( 0 );
+    return( (long) arith_context_models( ARITH_DEFAULT_CONTEXT,
+                                         sample_length ) *
+            (long) sizeof( FREQ_MODEL ) );
+}
+
+/*
+ * Neither engine ever writes more than 16 bits for a symbol, since
+ * no symbol has less than 1 / 65535 of the scale, and the '\0'
+ * terminator is a symbol too.  The flush and the range coder's
+ * cache byte take less than 8 more bytes.
+ */
+long arith_compress_bound( long length )
+{
+    return( 2 * ( length + 1 ) + 8 );
+}
+
+/*
+ * Sets up the positional models in the caller's workspace.  It has
+ * to be aligned for a FREQ_MODEL, as memory from malloc() is.
+ * Returns 0, or -1 if the workspace is too small.
+ */
+static int start_context( arith_ctx *ctx, int sample_length,
+                          void *workspace, long workspace_size )
+{
+    long size;
+
+    size = arith_workspace_size( sample_length );
+    if ( workspace_size < size )
+        return( -1 );
+    if ( size > 0 )
+        arith_set_context( ctx, ARITH_DEFAULT_CONTEXT, sample_length,
+                           (FREQ_MODEL *) workspace );
+    return( 0 );
 }
 
 /*
@@ -266,156 +595,292 @@ void remove_symbol_from_stream( uint16_t *stream, SYMBOL *s )
  * characters is loaded.  The modeling routines are called to
  * convert the character to a symbol, which has a high, low and
  * range.  Finally, the arithmetic coder module is called to
- * output the symbols to the bit stream.
+ * output the symbols to the bit stream.  sample_length is the
+ * number of characters per fixed format sample, 0 if the input has
+ * no such structure.  workspace must hold arith_workspace_size()
+ * bytes; nothing is allocated, so this is safe to run from static
+ * or external RAM pools.  The number of bytes written is returned,
+ * or -1 if the input could not be coded or did not fit in capacity,
+ * which is never the case with arith_compress_bound() bytes.
  */
-void compress(char* input, uint16_t* compressed_file)
+static long compress_with( const char* input, uint8_t* compressed_file,
+                           long capacity, int sample_length, void *workspace,
+                           long workspace_size, int engine )
 {
     int i;
     char c;
-    SYMBOL s;
+    arith_ctx ctx;
 
-    initialize_output_bitstream();
-    initialize_arithmetic_encoder();
+    arith_encoder_init( &ctx, compressed_file, capacity, engine );
+    if ( start_context( &ctx, sample_length, workspace, workspace_size ) != 0 )
+        return( -1 );
     for ( i=0 ; ; )
     {
         c = input[ i++ ];
-        convert_int_to_symbol( c, &s );
-        encode_symbol(compressed_file, &s );
-        if ( c == '\0' )
+        arith_encode( &ctx, c );
+        if ( ctx.stop || c == '\0' )
             break;
     }
-    flush_arithmetic_encoder(compressed_file );
-    flush_output_bitstream(compressed_file );
+    return( ctx.stop ? -1 : arith_encoder_flush( &ctx ) );
 }
 
 /*
  * This expansion routine demonstrates the basic algorithm used for
  * decompression in this article.  It first goes to the modeling
- * module and gets the scale for the current context.  (Note that
- * the scale is fixed here, since this is not an adaptive model).
- * It then asks the arithmetic decoder to give a high and low
- * value for the current input number scaled to match the current
- * range.  Finally, it asks the modeling unit to convert the
- * high and low values to a symbol.
+ * module and gets the scale for the current context.  It then asks
+ * the arithmetic decoder to give a high and low value for the
+ * current input number scaled to match the current range.  Finally,
+ * it asks the modeling unit to convert the high and low values to
+ * a symbol, which is written to the output.  The output is '\0'
+ * terminated when there is room.  sample_length must match the one
+ * given to the compressor, and workspace is as for compress_ws().
+ * The number of characters decoded is returned, or -1 on a corrupt
+ * stream or a full output.
  */
-void expand(uint16_t* compressed_file, char* input)
+static long expand_with( const uint8_t* compressed_file, long length,
+                         char* output, long capacity, int sample_length,
+                         void *workspace, long workspace_size, int engine )
 {
-    SYMBOL s;
-    char c;
-    unsigned int count;
-    unsigned int i = 0;
+    int c;
+    long i = 0;
+    arith_ctx ctx;
 
-    initialize_input_bitstream();
-    initialize_arithmetic_decoder( compressed_file );
-    for ( ; ; )
+    arith_decoder_init( &ctx, compressed_file, length, engine );
+    if ( start_context( &ctx, sample_length, workspace, workspace_size ) != 0 )
+        return( -1 );
+    while ( ( c = arith_decode( &ctx ) ) != DONE )
     {
-        s.scale = decode_distribution_size;
-        count = get_current_count( &s );
-        c = convert_symbol_to_int( count, &s );
-        if ( c == '\0' )
+        if ( i == capacity )
+        {
+            ctx.stop = 1;
             break;
-        remove_symbol_from_stream( compressed_file, &s );
-        if(c == input[i]){
-			if(DEBUG) putc( c, stdout );
         }
-		else{
-			error_exit("-> DATA CORRUPTED");
-        	printf("Expected [%c] but [%c] decoded\n", input[i], c);
-        	return;
-		}
-        i++;
+        output[ i++ ] = (char) c;
     }
-    if(DEBUG) putc( '\n', stdout );
+    if ( ctx.stop )
+        return( -1 );
+    if ( i < capacity )
+        output[ i ] = '\0';
+    return( i );
+}
+
+long compress_ws( const char* input, uint8_t* compressed_file, long capacity,
+                  int sample_length, void *workspace, long workspace_size )
+{
+    return( compress_with( input, compressed_file, capacity, sample_length,
+                           workspace, workspace_size, ARITH_DEFAULT_ENGINE ) );
+}
+
+long expand_ws( const uint8_t* compressed_file, long length, char* output,
+                long capacity, int sample_length, void *workspace,
+                long workspace_size )
+{
+    return( expand_with( compressed_file, length, output, capacity,
+                         sample_length, workspace, workspace_size,
+                         ARITH_DEFAULT_ENGINE ) );
+}
+
+/*
+ * compress_engine() and expand_engine() are the above with the
+ * workspace taken from the heap for the one call, and the engine
+ * picked by the caller, so both engines can be run side by side.
+ * compress() and expand() use ARITH_DEFAULT_ENGINE.
+ */
+long compress_engine( const char* input, uint8_t* compressed_file,
+                      long capacity, int sample_length, int engine )
+{
+    void *workspace;
+    long size;
+    long length;
+
+    size = arith_workspace_size( sample_length );
+    workspace = size > 0 ? MemAlloc( size ) : NULL;
+    if ( size > 0 && workspace == NULL )
+        return( -1 );
+    length = compress_with( input, compressed_file, capacity, sample_length,
+                            workspace, size, engine );
+    MemFree( workspace );
+    return( length );
+}
+
+long expand_engine( const uint8_t* compressed_file, long length,
+                    char* output, long capacity, int sample_length,
+                    int engine )
+{
+    void *workspace;
+    long size;
+    long decoded;
+
+    size = arith_workspace_size( sample_length );
+    workspace = size > 0 ? MemAlloc( size ) : NULL;
+    if ( size > 0 && workspace == NULL )
+        return( -1 );
+    decoded = expand_with( compressed_file, length, output, capacity,
+                           sample_length, workspace, size, engine );
+    MemFree( workspace );
+    return( decoded );
+}
+
+long compress(char* input, uint8_t* compressed_file, long capacity,
+              int sample_length)
+{
+    return( compress_engine( input, compressed_file, capacity,
+                             sample_length, ARITH_DEFAULT_ENGINE ) );
+}
+
+long expand(const uint8_t* compressed_file, long length, char* output,
+            long capacity, int sample_length)
+{
+    return( expand_engine( compressed_file, length, output, capacity,
+                           sample_length, ARITH_DEFAULT_ENGINE ) );
+}
+
+/*
+ * The byte mode versions of the above.  The input is length bytes
+ * of anything, and the output is not '\0' terminated.  Every byte
+ * costs at most 16 bits, and an escape and the flat symbol after it
+ * at most 16 more each, which happens once per symbol at most.
+ */
+long arith_byte_workspace_size( void )
+{
+    return( (long) sizeof( BYTE_MODEL ) );
+}
+
+long arith_compress_bytes_bound( long length )
+{
+    long novel = length < ESCAPE ? length + 1 : ESCAPE + 1;
+
+    return( 2 * ( length + 1 + novel ) + 8 );
+}
+
+long compress_bytes_ws( const uint8_t* input, long length,
+                        uint8_t* compressed_file, long capacity,
+                        void *workspace, long workspace_size )
+{
+    arith_ctx ctx;
+    long i;
+
+    if ( workspace_size < arith_byte_workspace_size() )
+        return( -1 );
+    arith_encoder_init( &ctx, compressed_file, capacity, ARITH_DEFAULT_ENGINE );
+    arith_set_byte_model( &ctx, (BYTE_MODEL *) workspace );
+    for ( i = 0 ; i < length && !ctx.stop ; i++ )
+        arith_encode_byte( &ctx, input[ i ] );
+    arith_encode_byte( &ctx, END_OF_STREAM );
+    return( ctx.stop ? -1 : arith_encoder_flush( &ctx ) );
+}
+
+long expand_bytes_ws( const uint8_t* compressed_file, long length,
+                      uint8_t* output, long capacity, void *workspace,
+                      long workspace_size )
+{
+    arith_ctx ctx;
+    long i = 0;
+    int c;
+
+    if ( workspace_size < arith_byte_workspace_size() )
+        return( -1 );
+    arith_decoder_init( &ctx, compressed_file, length, ARITH_DEFAULT_ENGINE );
+    arith_set_byte_model( &ctx, (BYTE_MODEL *) workspace );
+    while ( ( c = arith_decode_byte( &ctx ) ) != DONE )
+    {
+        if ( i == capacity )
+            return( -1 );
+        output[ i++ ] = (uint8_t) c;
+    }
+    return( ctx.stop ? -1 : i );
+}
+
+long compress_bytes( const uint8_t* input, long length,
+                     uint8_t* compressed_file, long capacity )
+{
+    void *workspace;
+    long result;
+
+    workspace = MemAlloc( arith_byte_workspace_size() );
+    if ( workspace == NULL )
+        return( -1 );
+    result = compress_bytes_ws( input, length, compressed_file, capacity,
+                                workspace, arith_byte_workspace_size() );
+    MemFree( workspace );
+    return( result );
+}
+
+long expand_bytes( const uint8_t* compressed_file, long length,
+                   uint8_t* output, long capacity )
+{
+    void *workspace;
+    long result;
+
+    workspace = MemAlloc( arith_byte_workspace_size() );
+    if ( workspace == NULL )
+        return( -1 );
+    result = expand_bytes_ws( compressed_file, length, output, capacity,
+                              workspace, arith_byte_workspace_size() );
+    MemFree( workspace );
+    return( result );
 }
 
 /*
  * This routine is called to convert a character read in from
  * the text input stream to a low, high, range SYMBOL.  This is
- * part of the modeling function.  In this case, all that needs
- * to be done is to find the character in the probabilities table
- * and then retrieve the low and high values for that symbol.
+ * part of the modeling function.  The character is mapped to its
+ * model index, its range is read from the model and then its
+ * count is updated.
  */
-void convert_int_to_symbol( char c, SYMBOL *s )
+void convert_int_to_symbol( arith_ctx *ctx, char c, SYMBOL *s )
 {
-    int i;
-    int j;
-    i=0;
-    for ( ; ; )
+    int index;
+    PROFILE_START( start );
+
+    index = symbol_index[ (unsigned char) c ] - 1;
+    if ( index < 0 )
     {
-        if ( c == probabilities_decoder[ i ].c )
-        {
-            s->low_count = probabilities_encoder[ i ].low;
-            s->high_count = probabilities_encoder[ i ].high;
-            s->scale = encode_distribution_size;
-
-            probabilities_encoder[ i ].high++;
-            for (j=i+1;j< sizeof(probabilities_encoder)/sizeof(probabilities_encoder[0]); j++){
-            	probabilities_encoder[j].low++;
-            	probabilities_encoder[j].high++;
-            }
-            encode_distribution_size++;
-            return;
-        }
-        if ( probabilities_decoder[i].c == '\0' )
-            error_exit( "Trying to encode a char not in the table" );
-        i++;
+        error_exit( ctx, "Trying to encode a char not in the table" );
+        return;
     }
+    model_get_symbol( ctx->current, index, s );
+    next_context( ctx, index );
+    PROFILE_STOP( PROFILE_MODEL, start );
 }
 
 /*
  * This modeling function is called to convert a SYMBOL value
  * consisting of a low, high, and range value into a text character
  * that can be sent to a file.  It does this by finding the symbol
- * in the probability table that straddles the current range.
+ * in the model that straddles the current range.
  */
-char convert_symbol_to_int( unsigned int count, SYMBOL *s )
+char convert_symbol_to_int( arith_ctx *ctx, unsigned int count, SYMBOL *s )
 {
-    int i;
-    int j;
-    i = 0;
-    for ( ; ; )
+    int index;
+    PROFILE_START( start );
+
+    if ( count >= ctx->current->total )
     {
-        if ( count >= probabilities_decoder[ i ].low &&
-             count < probabilities_decoder[ i ].high )
-        {
-            s->low_count = probabilities_decoder[ i ].low;
-            s->high_count = probabilities_decoder[ i ].high;
-            s->scale = decode_distribution_size;
-
-            probabilities_decoder[ i ].high++;
-			for (j=i+1;j< sizeof(probabilities_decoder)/sizeof(probabilities_decoder[0]); j++){
-				probabilities_decoder[j].low++;
-				probabilities_decoder[j].high++;
-			}
-			decode_distribution_size++;
-            return( probabilities_decoder[ i ].c );
-        }
-        if ( probabilities_decoder[ i ].c == '\0' ){
-            error_exit( "Failure to decode character" );
-        }
-        i++;
+        error_exit( ctx, "Failure to decode character" );
+        return( '\0' );
     }
+    index = model_find_symbol( ctx->current, count, s );
+    next_context( ctx, index );
+    PROFILE_STOP( PROFILE_MODEL, start );
+    return( symbol_chars[ index ] );
 }
 
 /*
  * A generic error routine.
  */
-void error_exit( char *message )
+void error_exit( arith_ctx *ctx, char *message )
 {
     puts( message );
-    stop = 1;
+    ctx->stop = 1;
 }
 
-void print_distribution(){
+void print_distribution( arith_ctx *ctx ){
 	int j;
+	SYMBOL s;
 	printf("   DISTRIBUTION\n");
-		printf(" ENCODER || DECODER\n");
-		for (j=0;j< sizeof(probabilities_encoder)/sizeof(probabilities_encoder[0]); j++)
-					printf("{%c,%i,%i} || {%c,%i,%i}\n",
-							probabilities_encoder[j].c,
-							probabilities_encoder[j].low,
-							probabilities_encoder[j].high,
-							probabilities_decoder[j].c,
-							probabilities_decoder[j].low,
-							probabilities_decoder[j].high);
+		for (j=0;j< SYMBOL_COUNT; j++){
+			model_get_symbol( ctx->current, j, &s );
+			printf("{%c,%i,%i}\n", symbol_chars[j], s.low_count, s.high_count);
+		}
 }
@@ -33,53 +33,166 @@
  *
  */
 
+#ifndef _ARITH_CODER_H_
+#define _ARITH_CODER_H_
+
 #include <stdint.h>
+#include "bitio.h"
+#include "arith_model.h"
+#include "range_coder.h"
+#include "schema.h"
 
 #define MAXIMUM_SCALE   16383  /* Maximum allowed frequency count */
 #define ESCAPE          256    /* The escape symbol               */
+#define END_OF_STREAM   257    /* Ends a byte mode stream         */
 #define DONE            -1     /* The output stream empty  symbol */
 #define FLUSH           -2     /* The symbol to flush the model   */
 
 /*
- * A symbol can either be represented as an int, or as a pair of
- * counts on a scale.  This structure gives a standard way of
- * defining it as a pair of counts.
+ * The coding engines a context can run.  The 16-bit coder is the
+ * original bit-at-a-time one, the 32-bit one is the byte oriented
+ * range coder from range_coder.c.  Both read the same model.
  */
-typedef struct {
-                unsigned short int low_count;
-                unsigned short int high_count;
-                unsigned short int scale;
-               } SYMBOL;
+#define ARITH_ENGINE_BIT16    0
+#define ARITH_ENGINE_RANGE32  1
+
+#ifndef ARITH_DEFAULT_ENGINE
+#define ARITH_DEFAULT_ENGINE  ARITH_ENGINE_BIT16  /* Used by compress() */
+#endif                                            /* and expand()       */
+
+#define SYMBOL_COUNT    ( SCHEMA_SYMBOLS + 1 ) /* The alphabet in  */
+                                       /* schema.h and '\0'  */
 
-extern long underflow_bits;    /* The present underflow count in  */
-                               /* the arithmetic coder.           */
+#if SYMBOL_COUNT > MODEL_MAX_SYMBOLS
+#error The alphabet does not fit in a model
+#endif
 
 /*
- * This is a the probability table for the symbol set used
- * in this example.  Each symbols has a low and high range,
- * and the total count is fixed at 11.
+ * How the model is picked for each character.  Samples are fixed
+ * format, so the position of a character within its sample says a
+ * lot about it: the '.' is always in the same place, and the high
+ * order digits barely change from one sample to the next.  With the
+ * positional contexts every position gets its own model, optionally
+ * one per value the previous sample had at that position.
  */
-typedef struct distribution{
-          char c;
-          unsigned int low;
-          unsigned int high;
-       } distribution;
+#define ARITH_CONTEXT_ORDER0    0  /* One model for every character   */
+#define ARITH_CONTEXT_POSITION  1  /* One model per sample position   */
+#define ARITH_CONTEXT_POS_PREV  2  /* One per position and per char   */
+                                   /* last seen at that position      */
+#define ARITH_MAX_POSITIONS     16 /* Longest sample for the above    */
 
+#ifndef ARITH_DEFAULT_CONTEXT
+#define ARITH_DEFAULT_CONTEXT   ARITH_CONTEXT_POS_PREV /* compress()  */
+#endif                                                 /* & expand()  */
+
+/*
+ * Everything one encoder or decoder needs is kept in this context:
+ * the coder registers, the adaptive model and the bit stream.  The
+ * caller owns the structure, so independent streams can be coded
+ * in parallel without any locking.
+ */
+typedef struct arith_ctx {
+          unsigned short int code;  /* The present input code value    */
+          unsigned short int low;   /* Start of the current code range */
+          unsigned short int high;  /* End of the current code range   */
+          long underflow_bits;      /* Number of underflow bits pending*/
+          RANGE_CODER rc;           /* Registers of the 32-bit engine  */
+          int engine;               /* ARITH_ENGINE_BIT16 or _RANGE32  */
+          FREQ_MODEL model;         /* The order-0 frequency model     */
+          FREQ_MODEL *models;       /* Caller's positional models      */
+          FREQ_MODEL *current;      /* Model for the next character    */
+          BYTE_MODEL *bytes;        /* Caller's model for byte mode    */
+          int context;              /* One of the ARITH_CONTEXT_ modes */
+          int sample_length;        /* Characters per sample           */
+          int position;             /* Position of the next character  */
+          uint8_t prev[ ARITH_MAX_POSITIONS ]; /* Last symbol at each  */
+                                               /* sample position      */
+          BIT_STREAM bits;
+          uint8_t stop;             /* Set when an error is detected   */
+       } arith_ctx;
+
+/*
+ * Context API.  The _init calls code to and from a single buffer.
+ * To stream through a sink or source instead, set up ctx->bits with
+ * initialize_output_sink() / initialize_input_source() and call the
+ * matching _start routine.
+ */
+void arith_encoder_init( arith_ctx *ctx, uint8_t *stream, long capacity,
+                         int engine );
+void arith_encoder_start( arith_ctx *ctx, int engine );
+void arith_encode( arith_ctx *ctx, char c );
+long arith_encoder_flush( arith_ctx *ctx );
+void arith_decoder_init( arith_ctx *ctx, const uint8_t *stream, long length,
+                         int engine );
+void arith_decoder_start( arith_ctx *ctx, int engine );
+int arith_decode( arith_ctx *ctx );
+int arith_context_models( int context, int sample_length );
+int arith_set_context( arith_ctx *ctx, int context, int sample_length,
+                       FREQ_MODEL *models );
+
+/*
+ * Byte mode, for any data rather than samples.  After the _init or
+ * _start call, arith_set_byte_model() hands over the model, then
+ * bytes or END_OF_STREAM are coded with the _byte calls.
+ */
+int arith_set_byte_model( arith_ctx *ctx, BYTE_MODEL *model );
+void arith_encode_byte( arith_ctx *ctx, int symbol );
+int arith_decode_byte( arith_ctx *ctx );
 
 /*
  * Function prototypes.
  */
-void initialize_arithmetic_decoder( uint16_t *stream );
-void remove_symbol_from_stream( uint16_t *stream, SYMBOL *s );
-void initialize_arithmetic_encoder( void );
-void encode_symbol( uint16_t *stream, SYMBOL *s );
-void flush_arithmetic_encoder( uint16_t *stream );
-unsigned short int get_current_count( SYMBOL *s );
-
-void compress(char * input, uint16_t* compressed_file);
-void expand(uint16_t* compressed_file, char* input);
-void convert_int_to_symbol( char c, SYMBOL *s );
-char convert_symbol_to_int( unsigned int count, SYMBOL *s );
-void error_exit( char *message );
-
-void print_distribution();
+void initialize_model( arith_ctx *ctx );
+void initialize_arithmetic_decoder( arith_ctx *ctx );
+void remove_symbol_from_stream( arith_ctx *ctx, SYMBOL *s );
+void initialize_arithmetic_encoder( arith_ctx *ctx );
+void encode_symbol( arith_ctx *ctx, SYMBOL *s );
+void flush_arithmetic_encoder( arith_ctx *ctx );
+unsigned short int get_current_count( arith_ctx *ctx, SYMBOL *s );
+
+long compress(char * input, uint8_t* compressed_file, long capacity,
+              int sample_length);
+long expand(const uint8_t* compressed_file, long length, char* output,
+            long capacity, int sample_length);
+long compress_engine( const char* input, uint8_t* compressed_file,
+                      long capacity, int sample_length, int engine );
+long expand_engine( const uint8_t* compressed_file, long length,
+                    char* output, long capacity, int sample_length,
+                    int engine );
+
+/*
+ * The same without any allocation.  The positional models go in the
+ * caller's workspace of arith_workspace_size() bytes, aligned as by
+ * malloc(), and arith_compress_bound() bytes of output are always
+ * enough.
+ */
+long arith_workspace_size( int sample_length );
+long arith_compress_bound( long length );
+long compress_ws( const char* input, uint8_t* compressed_file, long capacity,
+                  int sample_length, void *workspace, long workspace_size );
+long expand_ws( const uint8_t* compressed_file, long length, char* output,
+                long capacity, int sample_length, void *workspace,
+                long workspace_size );
+
+/*
+ * Whole buffers in byte mode, with the same workspace scheme.
+ */
+long arith_byte_workspace_size( void );
+long arith_compress_bytes_bound( long length );
+long compress_bytes( const uint8_t* input, long length,
+                     uint8_t* compressed_file, long capacity );
+long expand_bytes( const uint8_t* compressed_file, long length,
+                   uint8_t* output, long capacity );
+long compress_bytes_ws( const uint8_t* input, long length,
+                        uint8_t* compressed_file, long capacity,
+                        void *workspace, long workspace_size );
+long expand_bytes_ws( const uint8_t* compressed_file, long length,
+                      uint8_t* output, long capacity, void *workspace,
+                      long workspace_size );
+void convert_int_to_symbol( arith_ctx *ctx, char c, SYMBOL *s );
+char convert_symbol_to_int( arith_ctx *ctx, unsigned int count, SYMBOL *s );
+void error_exit( arith_ctx *ctx, char *message );
+
+void print_distribution( arith_ctx *ctx );
+
+#endif  /* ndef _ARITH_CODER_H_ */
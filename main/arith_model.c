@@ -0,0 +1,202 @@
+/*
+ * arith_model.c
+ *
+ * This file contains the adaptive order-0 model used by the
+ * arithmetic coder.  Every symbol starts with a count of one.  Each
+ * time a symbol is coded its count is bumped, and when the total
+ * reaches the model's limit all the counts are halved, so the scale
+ * never outgrows the precision of the coder.
+ *
+ * The cumulative counts are kept in a binary indexed tree, which
+ * turns the linear table scans of the original model into
+ * O(log n) walks.
+ *
+ * The byte model is the same tree over all 256 byte values and two
+ * control symbols, but it starts with every count at zero.
+ */
+
+#include <string.h>
+#include "arith_model.h"
+
+#define BYTE_MODEL_TOP_BIT  256    /* Largest power of 2 <= symbols */
+
+/*
+ * The tree code works on bare arrays so that both model sizes share
+ * it.  tree[] is 1 based, freq[] is 0 based and n is the number of
+ * symbols.  The tree is rebuilt from the plain frequency table in
+ * O(n) by pushing each node's sum up to its parent, and the total
+ * is returned.
+ */
+static uint16_t tree_build( uint16_t *tree, const uint16_t *freq, int n )
+{
+    uint16_t total = 0;
+    int i;
+    int parent;
+
+    tree[ 0 ] = 0;
+    for ( i = 1 ; i <= n ; i++ )
+    {
+        tree[ i ] = freq[ i - 1 ];
+        total += freq[ i - 1 ];
+    }
+    for ( i = 1 ; i <= n ; i++ )
+    {
+        parent = i + ( i & -i );
+        if ( parent <= n )
+            tree[ parent ] += tree[ i ];
+    }
+    return( total );
+}
+
+static uint16_t tree_top_bit( int n )
+{
+    uint16_t top_bit = 1;
+
+    while ( ( top_bit << 1 ) <= n )
+        top_bit <<= 1;
+    return( top_bit );
+}
+
+/*
+ * The low count of a symbol is the sum of the frequencies of every
+ * symbol before it, which is a walk down the tree towards index 0.
+ */
+static unsigned int tree_low( const uint16_t *tree, int index )
+{
+    unsigned int low = 0;
+    int i;
+
+    for ( i = index ; i > 0 ; i -= i & -i )
+        low += tree[ i ];
+    return( low );
+}
+
+/*
+ * When decoding, the symbol whose range straddles count is found by
+ * walking the tree from the top bit down, keeping the largest prefix
+ * whose sum is still <= count.  Symbols with a zero count have the
+ * same prefix as the next one, so they are walked past and never
+ * found.  The index of the symbol is returned.
+ */
+static int tree_find( const uint16_t *tree, int n, uint16_t top_bit,
+                      unsigned int count, unsigned int *low )
+{
+    int index = 0;
+    int step;
+
+    *low = 0;
+    for ( step = top_bit ; step > 0 ; step >>= 1 )
+    {
+        if ( index + step <= n && *low + tree[ index + step ] <= count )
+        {
+            index += step;
+            *low += tree[ index ];
+        }
+    }
+    return( index );
+}
+
+/*
+ * After a symbol is coded its count goes up by one.  Once the total
+ * hits the limit every count is halved, rounding up, so the counts
+ * that were non zero stay that way and the zero ones stay zero.
+ */
+static void tree_update( uint16_t *tree, uint16_t *freq, int n,
+                         uint16_t *total, uint16_t limit, int index )
+{
+    int i;
+
+    freq[ index ]++;
+    ( *total )++;
+    for ( i = index + 1 ; i <= n ; i += i & -i )
+        tree[ i ]++;
+    if ( *total >= limit )
+    {
+        for ( i = 0 ; i < n ; i++ )
+            freq[ i ] = ( freq[ i ] + 1 ) >> 1;
+        *total = tree_build( tree, freq, n );
+    }
+}
+
+/*
+ * A new model gives every symbol in the alphabet a count of one.
+ */
+void model_init( FREQ_MODEL *m, int symbols, uint16_t limit )
+{
+    int i;
+
+    m->symbols = symbols;
+    m->limit = limit;
+    m->top_bit = tree_top_bit( symbols );
+    for ( i = 0 ; i < symbols ; i++ )
+        m->freq[ i ] = 1;
+    m->total = tree_build( m->tree, m->freq, symbols );
+}
+
+void model_get_symbol( const FREQ_MODEL *m, int index, SYMBOL *s )
+{
+    unsigned int low = tree_low( m->tree, index );
+
+    s->low_count = low;
+    s->high_count = low + m->freq[ index ];
+    s->scale = m->total;
+}
+
+int model_find_symbol( const FREQ_MODEL *m, unsigned int count, SYMBOL *s )
+{
+    unsigned int low;
+    int index;
+
+    index = tree_find( m->tree, m->symbols, m->top_bit, count, &low );
+    s->low_count = low;
+    s->high_count = low + m->freq[ index ];
+    s->scale = m->total;
+    return( index );
+}
+
+void model_update( FREQ_MODEL *m, int index )
+{
+    tree_update( m->tree, m->freq, m->symbols, &m->total, m->limit, index );
+}
+
+/*
+ * A byte model starts out empty: every count is zero until the
+ * symbol is first coded, so only the symbols that have been seen
+ * take up any of the range.  The coder has to give the model a
+ * symbol it can always code, its escape, before the first lookup.
+ */
+void byte_model_init( BYTE_MODEL *m, uint16_t limit )
+{
+    m->limit = limit;
+    memset( m->freq, 0, sizeof( m->freq ) );
+    m->total = tree_build( m->tree, m->freq, BYTE_MODEL_SYMBOLS );
+}
+
+void byte_model_get_symbol( const BYTE_MODEL *m, int index, SYMBOL *s )
+{
+    unsigned int low = tree_low( m->tree, index );
+
+    s->low_count = low;
+    s->high_count = low + m->freq[ index ];
+    s->scale = m->total;
+}
+
+int byte_model_find_symbol( const BYTE_MODEL *m, unsigned int count,
+                            SYMBOL *s )
+{
+    unsigned int low;
+    int index;
+
+    index = tree_find( m->tree, BYTE_MODEL_SYMBOLS, BYTE_MODEL_TOP_BIT,
+                       count, &low );
+    s->low_count = low;
+    s->high_count = low + m->freq[ index ];
+    s->scale = m->total;
+    return( index );
+}
+
+void byte_model_update( BYTE_MODEL *m, int index )
+{
+    tree_update( m->tree, m->freq, BYTE_MODEL_SYMBOLS, &m->total, m->limit,
+                 index );
+}
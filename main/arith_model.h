@@ -0,0 +1,69 @@
+/*
+ * arith_model.h
+ *
+ * This header file contains the declarations needed to use the
+ * adaptive frequency model of the arithmetic coder.  The model keeps
+ * its cumulative counts in a binary indexed (Fenwick) tree, so that
+ * looking up a symbol's range, finding the symbol that straddles a
+ * count and updating a count all take O(log n) steps instead of a
+ * walk over the whole table.
+ *
+ */
+
+#ifndef _ARITH_MODEL_H_
+#define _ARITH_MODEL_H_
+
+#include <stdint.h>
+
+#define MODEL_MAX_SYMBOLS   16     /* Largest alphabet a model can hold */
+
+/*
+ * A symbol can either be represented as an int, or as a pair of
+ * counts on a scale.  This structure gives a standard way of
+ * defining it as a pair of counts.
+ */
+typedef struct {
+                unsigned short int low_count;
+                unsigned short int high_count;
+                unsigned short int scale;
+               } SYMBOL;
+
+/*
+ * tree[] is 1 based: tree[ i ] holds the sum of the frequencies of
+ * the symbols in ( i - ( i & -i ), i ].  freq[] keeps the plain
+ * frequency of every symbol so the high count is one add away.
+ */
+typedef struct {
+                uint16_t tree[ MODEL_MAX_SYMBOLS + 1 ];
+                uint16_t freq[ MODEL_MAX_SYMBOLS ];
+                uint16_t symbols;    /* Symbols in the alphabet        */
+                uint16_t top_bit;    /* Largest power of 2 <= symbols  */
+                uint16_t total;      /* Sum of all the frequencies     */
+                uint16_t limit;      /* Total that triggers a rescale  */
+               } FREQ_MODEL;
+
+/*
+ * The byte model covers every byte value plus two symbols for the
+ * coder's own use, the escape and the end of stream in arith_coder.h.
+ */
+#define BYTE_MODEL_SYMBOLS  258
+
+typedef struct {
+                uint16_t tree[ BYTE_MODEL_SYMBOLS + 1 ];
+                uint16_t freq[ BYTE_MODEL_SYMBOLS ];
+                uint16_t total;      /* Sum of all the frequencies     */
+                uint16_t limit;      /* Total that triggers a rescale  */
+               } BYTE_MODEL;
+
+void model_init( FREQ_MODEL *m, int symbols, uint16_t limit );
+void model_get_symbol( const FREQ_MODEL *m, int index, SYMBOL *s );
+int model_find_symbol( const FREQ_MODEL *m, unsigned int count, SYMBOL *s );
+void model_update( FREQ_MODEL *m, int index );
+
+void byte_model_init( BYTE_MODEL *m, uint16_t limit );
+void byte_model_get_symbol( const BYTE_MODEL *m, int index, SYMBOL *s );
+int byte_model_find_symbol( const BYTE_MODEL *m, unsigned int count,
+                            SYMBOL *s );
+void byte_model_update( BYTE_MODEL *m, int index );
+
+#endif  /* ndef _ARITH_MODEL_H_ */
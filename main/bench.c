@@ -0,0 +1,587 @@
+/***************************************************************************
+*                         Codec Benchmark Driver
+*
+*   File    : bench.c
+*   Purpose : Times the codecs on corpus data.  Input preparation, the
+*             strip and parse steps, is done once up front and is not
+*             timed, and every result is checked once against the input
+*             before any timing.  Runs too short for the microsecond
+*             timer are timed in batches: during warmup the batch is
+*             doubled until it takes BENCH_MIN_BATCH_US, and each timed
+*             repeat is one batch.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "corpus.h"
+#include "transform.h"
+#include "arith_coder.h"
+#include "lzw.h"
+#include "delta_codec.h"
+#include "port.h"
+#include "memtrack.h"
+#include "schema.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    char *text;                 /* the corpus as sample text */
+    long textLength;
+    char *stripped;             /* the text without the '.'s */
+    long strippedLength;
+    int32_t *values;            /* the samples as fixed point values */
+    long count;
+    int sampleLength;           /* chars per stripped sample */
+    uint8_t *coded;             /* coder output */
+    long codedCapacity;
+    long codedLength;
+    char *decodedText;          /* decoder output */
+    int32_t *decodedValues;
+} bench_data_t;
+
+typedef struct
+{
+    double median;              /* ns per run */
+    double p99;
+} bench_time_t;
+
+typedef struct
+{
+    size_t peakHeap;            /* most tracked heap in one direction */
+    unsigned long allocations;  /* tracked allocations in both */
+    size_t peakStack;           /* most stack in one direction */
+} bench_memory_t;
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+static const char *codecNames[BENCH_CODECS] =
+    {"arith", "lzw", "delta", "arith-range"};
+
+#define MAX_BATCH       (1L << 20)
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : BenchCodecName
+*   Description: Name of a codec for reports.
+***************************************************************************/
+const char *BenchCodecName(int codec)
+{
+    return ((codec >= 0) && (codec < BENCH_CODECS)) ?
+        codecNames[codec] : "unknown";
+}
+
+/***************************************************************************
+*   Function   : BenchDefaults
+*   Description: The default sweep: all codecs and corpora, sizes from
+*                one block of samples to what fits an ESP32 comfortably,
+*                in the format main.c uses, printed as CSV.
+***************************************************************************/
+void BenchDefaults(bench_config_t *config)
+{
+    static const long sizes[] = {64, 256, 1024, 4096, 16384};
+
+    config->sizes = sizes;
+    config->sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+    config->codecs = (1U << BENCH_CODECS) - 1;
+    config->corpora = (1U << (CORPUS_TRACE + 1)) - 1;
+    config->trace = NULL;
+    config->warmup = 3;
+    config->repeats = 31;
+    config->output = BENCH_CSV;
+    config->seed = 1;
+    config->integerDigits = SCHEMA_INTEGER_DIGITS;
+    config->decimalDigits = SCHEMA_DECIMAL_DIGITS;
+}
+
+/***************************************************************************
+*   Function   : Encode / Decode
+*   Description: One run of a codec in each direction.
+*   Returned   : Bytes written by Encode, or samples, chars or values
+*                written by Decode, -1 on failure.
+***************************************************************************/
+static long Encode(int codec, bench_data_t *data)
+{
+    switch (codec)
+    {
+        case BENCH_ARITH:
+            return compress_engine(data->stripped, data->coded,
+                data->codedCapacity, data->sampleLength, ARITH_ENGINE_BIT16);
+
+        case BENCH_ARITH_RANGE:
+            return compress_engine(data->stripped, data->coded,
+                data->codedCapacity, data->sampleLength,
+                ARITH_ENGINE_RANGE32);
+
+        case BENCH_LZW:
+            return LZWEncode(data->stripped, data->coded,
+                data->codedCapacity);
+
+        case BENCH_DELTA:
+            return DeltaEncode(data->values, data->count, data->coded,
+                data->codedCapacity);
+    }
+
+    return -1;
+}
+
+static long Decode(int codec, bench_data_t *data)
+{
+    switch (codec)
+    {
+        case BENCH_ARITH:
+            return expand_engine(data->coded, data->codedLength,
+                data->decodedText, data->strippedLength + 1,
+                data->sampleLength, ARITH_ENGINE_BIT16);
+
+        case BENCH_ARITH_RANGE:
+            return expand_engine(data->coded, data->codedLength,
+                data->decodedText, data->strippedLength + 1,
+                data->sampleLength, ARITH_ENGINE_RANGE32);
+
+        case BENCH_LZW:
+            return LZWDecode(data->coded, data->codedLength,
+                data->decodedText, data->strippedLength + 1);
+
+        case BENCH_DELTA:
+            return DeltaDecode(data->coded, data->codedLength,
+                data->decodedValues, data->count);
+    }
+
+    return -1;
+}
+
+/***************************************************************************
+*   Function   : Track / Tracked
+*   Description: Start and finish the memory measurement of one run.
+*                The stack mark has to be taken in the function that
+*                makes the run, so that is left to the caller.
+***************************************************************************/
+static size_t Track(void)
+{
+    mem_stats_t stats;
+
+    MemResetStats();
+    MemGetStats(&stats);
+
+    return stats.current;
+}
+
+static void Tracked(size_t base, size_t stack, bench_memory_t *memory)
+{
+    mem_stats_t stats;
+
+    MemGetStats(&stats);
+
+    if (stats.peak - base > memory->peakHeap)
+    {
+        memory->peakHeap = stats.peak - base;
+    }
+
+    if (stack > memory->peakStack)
+    {
+        memory->peakStack = stack;
+    }
+
+    memory->allocations += stats.allocations;
+}
+
+/***************************************************************************
+*   Function   : RoundTrip
+*   Description: Codes and decodes once, measuring the memory each
+*                direction takes, and compares with the input.
+*   Returned   : 0 if the input came back, -1 otherwise.
+***************************************************************************/
+static int RoundTrip(int codec, bench_data_t *data, bench_memory_t *memory)
+{
+    mem_stack_t mark;
+    size_t base;
+    long decoded;
+
+    memset(memory, 0, sizeof(bench_memory_t));
+
+    base = Track();
+    mark = MemStackMark(BENCH_STACK_PROBE);
+    data->codedLength = Encode(codec, data);
+    Tracked(base, MemStackUsed(&mark), memory);
+
+    if (data->codedLength < 0)
+    {
+        return -1;
+    }
+
+    base = Track();
+    mark = MemStackMark(BENCH_STACK_PROBE);
+    decoded = Decode(codec, data);
+    Tracked(base, MemStackUsed(&mark), memory);
+
+    if (codec == BENCH_DELTA)
+    {
+        return ((decoded == data->count) &&
+            (memcmp(data->decodedValues, data->values,
+                data->count * sizeof(int32_t)) == 0)) ? 0 : -1;
+    }
+
+    return ((decoded == data->strippedLength) &&
+        (memcmp(data->decodedText, data->stripped,
+            data->strippedLength) == 0)) ? 0 : -1;
+}
+
+/***************************************************************************
+*   Function   : RunBatch
+*   Description: Runs a codec batch times in one direction.
+*   Returned   : Microseconds taken, -1 if a run failed.
+***************************************************************************/
+static int64_t RunBatch(int codec, int decode, bench_data_t *data,
+    long batch)
+{
+    int64_t start;
+    long i;
+
+    start = PortTimeUs();
+
+    for (i = 0; i < batch; i++)
+    {
+        if ((decode ? Decode(codec, data) : Encode(codec, data)) < 0)
+        {
+            return -1;
+        }
+    }
+
+    return PortTimeUs() - start;
+}
+
+/***************************************************************************
+*   Function   : CompareTimes
+*   Description: qsort order for run times.
+***************************************************************************/
+static int CompareTimes(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/***************************************************************************
+*   Function   : Measure
+*   Description: This routine warms a codec up, sizes the batch and then
+*                times config->repeats batches in one direction.
+*   Parameters : codec - the BENCH_ codec
+*                decode - 0 to time coding, 1 to time decoding
+*                data - the prepared input, already round tripped
+*                config - warmup and repeat counts
+*                times - where the median and p99 ns per run go
+*   Returned   : 0 for success, -1 if a run failed.
+***************************************************************************/
+static int Measure(int codec, int decode, bench_data_t *data,
+    const bench_config_t *config, bench_time_t *times)
+{
+    double *runs;
+    int repeats = config->repeats;
+    int64_t elapsed;
+    long batch = 1;
+    int i;
+
+    if (RunBatch(codec, decode, data, config->warmup) < 0)
+    {
+        return -1;
+    }
+
+    while (((elapsed = RunBatch(codec, decode, data, batch)) >= 0) &&
+        (elapsed < BENCH_MIN_BATCH_US) && (batch < MAX_BATCH))
+    {
+        batch *= 2;
+    }
+
+    if (elapsed < 0)
+    {
+        return -1;
+    }
+
+    if (repeats > BENCH_MAX_REPEATS)
+    {
+        repeats = BENCH_MAX_REPEATS;
+    }
+
+    if (repeats < 1)
+    {
+        repeats = 1;
+    }
+
+    /* too big for the ESP32 main task's stack */
+    runs = malloc(repeats * sizeof(double));
+
+    if (NULL == runs)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < repeats; i++)
+    {
+        elapsed = RunBatch(codec, decode, data, batch);
+
+        if (elapsed < 0)
+        {
+            free(runs);
+            return -1;
+        }
+
+        runs[i] = (elapsed * 1000.0) / batch;
+    }
+
+    qsort(runs, repeats, sizeof(double), CompareTimes);
+    times->median = runs[(repeats - 1) / 2];
+    times->p99 = runs[(repeats * 99 + 99) / 100 - 1];
+    free(runs);
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : Prepare
+*   Description: Generates the corpus, or reads it from the trace, and
+*                the stripped and parsed forms of it, and sizes the coder
+*                buffers.  A trace shorter than samples gives all it has.
+*   Returned   : 0 for success, -1 if out of memory or the trace cannot
+*                be read.
+***************************************************************************/
+static int Prepare(bench_data_t *data, int kind, long samples,
+    const bench_config_t *config)
+{
+    int sampleLength = SCHEMA_SAMPLE_CHARS(config->integerDigits,
+        config->decimalDigits);
+
+    memset(data, 0, sizeof(bench_data_t));
+    data->textLength = samples * sampleLength;
+    data->count = samples;
+    data->sampleLength = sampleLength - 1;
+    data->codedCapacity = 2 * data->textLength + 8;
+
+    if (data->codedCapacity < DeltaCompressBound(samples))
+    {
+        data->codedCapacity = DeltaCompressBound(samples);
+    }
+
+    data->text = malloc(data->textLength + 1);
+    data->stripped = malloc(data->textLength + 1);
+    data->decodedText = malloc(data->textLength + 1);
+    data->values = malloc((samples + 1) * sizeof(int32_t));
+    data->decodedValues = malloc((samples + 1) * sizeof(int32_t));
+    data->coded = malloc(data->codedCapacity);
+
+    if ((NULL == data->text) || (NULL == data->stripped) ||
+        (NULL == data->decodedText) || (NULL == data->values) ||
+        (NULL == data->decodedValues) || (NULL == data->coded))
+    {
+        return -1;
+    }
+
+    if (kind == CORPUS_TRACE)
+    {
+        data->count = CorpusLoadTrace(config->trace, data->values, samples,
+            config->integerDigits, config->decimalDigits);
+
+        if (data->count < 1)
+        {
+            return -1;
+        }
+
+        data->textLength = data->count * sampleLength;
+
+        if (TransformFormat(data->values, data->count, data->text,
+            data->textLength + 1, config->integerDigits,
+            config->decimalDigits) < 0)
+        {
+            return -1;
+        }
+    }
+    else if (CorpusText(kind, config->seed, data->text, data->textLength + 1,
+        samples, config->integerDigits, config->decimalDigits) < 0)
+    {
+        return -1;
+    }
+
+    if (TransformParse(data->text, data->textLength, data->values,
+        config->integerDigits, config->decimalDigits) != data->count)
+    {
+        return -1;
+    }
+
+    data->strippedLength = TransformStrip(data->text, data->textLength,
+        data->stripped, config->integerDigits, config->decimalDigits);
+
+    return (data->strippedLength < 0) ? -1 : 0;
+}
+
+static void Release(bench_data_t *data)
+{
+    free(data->text);
+    free(data->stripped);
+    free(data->decodedText);
+    free(data->values);
+    free(data->decodedValues);
+    free(data->coded);
+}
+
+/***************************************************************************
+*   Function   : Report
+*   Description: Prints one result in the configured format.  MB/s are
+*                10^6 bytes of sample text per second, and the p99 MB/s
+*                is the throughput of the p99 run time, the slow tail.
+***************************************************************************/
+static void Report(const bench_config_t *config, int first, int kind,
+    int codec, const bench_data_t *data, const bench_time_t *encode,
+    const bench_time_t *decode, const bench_memory_t *memory)
+{
+    double bytes = data->textLength;
+
+    if (config->output == BENCH_JSON)
+    {
+        printf("%s  {\"corpus\": \"%s\", \"codec\": \"%s\", "
+            "\"samples\": %ld, \"bytes\": %ld, \"compressed\": %ld, "
+            "\"ratio\": %.4f, "
+            "\"comp_mbs_median\": %.3f, \"comp_mbs_p99\": %.3f, "
+            "\"decomp_mbs_median\": %.3f, \"decomp_mbs_p99\": %.3f, "
+            "\"comp_ns_symbol\": %.2f, \"decomp_ns_symbol\": %.2f, "
+            "\"peak_heap\": %lu, \"allocations\": %lu, "
+            "\"peak_stack\": %lu}",
+            first ? "" : ",\n", CorpusName(kind), codecNames[codec],
+            data->count, data->textLength, data->codedLength,
+            bytes / data->codedLength,
+            bytes * 1000.0 / encode->median, bytes * 1000.0 / encode->p99,
+            bytes * 1000.0 / decode->median, bytes * 1000.0 / decode->p99,
+            encode->median / bytes, decode->median / bytes,
+            (unsigned long)memory->peakHeap, memory->allocations,
+            (unsigned long)memory->peakStack);
+    }
+    else
+    {
+        printf("%s,%s,%ld,%ld,%ld,%.4f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f,"
+            "%lu,%lu,%lu\n",
+            CorpusName(kind), codecNames[codec],
+            data->count, data->textLength, data->codedLength,
+            bytes / data->codedLength,
+            bytes * 1000.0 / encode->median, bytes * 1000.0 / encode->p99,
+            bytes * 1000.0 / decode->median, bytes * 1000.0 / decode->p99,
+            encode->median / bytes, decode->median / bytes,
+            (unsigned long)memory->peakHeap, memory->allocations,
+            (unsigned long)memory->peakStack);
+    }
+}
+
+/***************************************************************************
+*   Function   : BenchRun
+*   Description: This routine runs the whole sweep, corpus kind by size
+*                by codec, printing a result as each one finishes.  A
+*                codec that fails or does not round trip is reported on
+*                stderr and skipped, and the sweep carries on.
+*   Parameters : config - the sweep to run
+*   Effects    : The results are printed to stdout
+*   Returned   : 0 if every combination ran, -1 otherwise.
+***************************************************************************/
+int BenchRun(const bench_config_t *config)
+{
+    bench_data_t data;
+    bench_time_t encode;
+    bench_time_t decode;
+    bench_memory_t memory;
+    int result = 0;
+    int first = 1;
+    int kind;
+    int size;
+    int codec;
+    long traced;                /* samples in the trace, once known */
+
+    if (config->output == BENCH_JSON)
+    {
+        printf("[\n");
+    }
+    else
+    {
+        printf("corpus,codec,samples,bytes,compressed,ratio,"
+            "comp_mbs_median,comp_mbs_p99,decomp_mbs_median,decomp_mbs_p99,"
+            "comp_ns_symbol,decomp_ns_symbol,peak_heap,allocations,"
+            "peak_stack\n");
+    }
+
+    for (kind = 0; kind <= CORPUS_TRACE; kind++)
+    {
+        if (!(config->corpora & (1U << kind)) ||
+            ((kind == CORPUS_TRACE) && (NULL == config->trace)))
+        {
+            continue;
+        }
+
+        traced = -1;
+
+        for (size = 0; size < config->sizeCount; size++)
+        {
+            /* a short trace is swept once at its full length */
+            if ((traced >= 0) && (config->sizes[size] > traced))
+            {
+                continue;
+            }
+
+            if (Prepare(&data, kind, config->sizes[size], config) != 0)
+            {
+                fprintf(stderr, "%s %ld: cannot prepare the corpus\n",
+                    CorpusName(kind), config->sizes[size]);
+                Release(&data);
+                result = -1;
+                continue;
+            }
+
+            if ((kind == CORPUS_TRACE) && (data.count < config->sizes[size]))
+            {
+                traced = data.count;
+            }
+
+            for (codec = 0; codec < BENCH_CODECS; codec++)
+            {
+                if (!(config->codecs & (1U << codec)))
+                {
+                    continue;
+                }
+
+                /* memory is taken from a second round trip, once the
+                 * first calls into the C library are out of the way */
+                if ((RoundTrip(codec, &data, &memory) != 0) ||
+                    (Measure(codec, 0, &data, config, &encode) != 0) ||
+                    (Measure(codec, 1, &data, config, &decode) != 0) ||
+                    (RoundTrip(codec, &data, &memory) != 0))
+                {
+                    fprintf(stderr, "%s %s %ld: codec failed\n",
+                        CorpusName(kind), codecNames[codec],
+                        config->sizes[size]);
+                    result = -1;
+                    continue;
+                }
+
+                Report(config, first, kind, codec, &data, &encode, &decode,
+                    &memory);
+                first = 0;
+            }
+
+            Release(&data);
+        }
+    }
+
+    if (config->output == BENCH_JSON)
+    {
+        printf("\n]\n");
+    }
+
+    return result;
+}
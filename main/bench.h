@@ -0,0 +1,82 @@
+/***************************************************************************
+*                         Codec Benchmark Driver
+*
+*   File    : bench.h
+*   Purpose : Provides prototypes for the benchmark sweep.  Every codec
+*             is run on every corpus kind at every size, with warmup
+*             runs first and then a number of timed repeats, and one
+*             result line per combination is printed as CSV or JSON.
+*             A recorded trace, if one is given, is swept as one more
+*             corpus, taking its first samples for each size.
+*             The throughput and ns/symbol figures count the chars of
+*             the sample text, so the codecs are compared on the same
+*             input whatever they actually code.  Memory is measured on
+*             an untimed round trip: the peak heap through the codecs'
+*             tracked allocator, the number of allocations, and the
+*             stack used below the benchmark's own frame.
+*
+***************************************************************************/
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define BENCH_CSV           0
+#define BENCH_JSON          1
+
+#define BENCH_ARITH         0   /* compress() on the stripped text */
+#define BENCH_LZW           1   /* LZWEncode() on the stripped text */
+#define BENCH_DELTA         2   /* DeltaEncode() on the parsed values */
+#define BENCH_ARITH_RANGE   3   /* compress() with the 32-bit range coder */
+#define BENCH_CODECS        4
+
+#define BENCH_MAX_REPEATS   1000
+#define BENCH_MIN_BATCH_US  1000    /* shortest timed batch of runs */
+
+/* stack painted for the stack measurement, it must fit in what is left
+ * of the ESP32 main task's stack */
+#ifdef ESP_PLATFORM
+#define BENCH_STACK_PROBE   1024
+#else
+#define BENCH_STACK_PROBE   16384
+#endif
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    const long *sizes;          /* sample counts to sweep */
+    int sizeCount;
+    unsigned codecs;            /* bit per BENCH_ codec to run */
+    unsigned corpora;           /* bit per CORPUS_ kind to run */
+    const char *trace;          /* trace file for CORPUS_TRACE, or NULL */
+    int warmup;                 /* untimed runs before measuring */
+    int repeats;                /* timed runs, up to BENCH_MAX_REPEATS */
+    int output;                 /* BENCH_CSV or BENCH_JSON */
+    uint64_t seed;              /* corpus seed */
+    int integerDigits;          /* the sample format */
+    int decimalDigits;
+} bench_config_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* name of a BENCH_ codec for reports */
+const char *BenchCodecName(int codec);
+
+/* fill in the default sweep */
+void BenchDefaults(bench_config_t *config);
+
+/* run the sweep and print the results, returns 0 or -1 if a codec
+ * failed or did not round trip */
+int BenchRun(const bench_config_t *config);
+
+#endif  /* ndef _BENCH_H_ */
@@ -31,138 +31,242 @@
  * know about these is that the first bit is stored in the msb of
  * the first byte of the output, like you might expect.
  *
- * Both input and output maintain a local buffer so that they only
- * have to do block reads and writes.  This is done in spite of the
- * fact that C standard I/O does the same thing.  If these
- * routines are ever ported to assembly language the buffering
- * will come in handy.
+ * Bits are collected in a 64-bit accumulator and moved to and from
+ * the caller's buffer a machine word at a time, so the per bit work
+ * is a shift and an or.  Output goes straight into the caller's
+ * buffer; when a sink is attached the buffer is drained into it
+ * whenever it fills, and input is refilled from a source the same
+ * way.  All of this state is kept in the BIT_STREAM structure the
+ * caller passes in, so independent streams can be coded at the same
+ * time, e.g. one on each ESP32 core.
  *
  */
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "bitio.h"
-#include "arith_coder.h"
 
-#define BUFFER_SIZE 256
-static char buffer[ BUFFER_SIZE + 2 ]; /* This is the i/o buffer    */
-static char *current_byte;             /* Pointer to current byte   */
+/*
+ * This routine is called once to initialze the output bitstream.
+ * All it has to do is point at the caller's buffer and empty the
+ * accumulator.  The whole stream has to fit in capacity bytes.
+ */
+void initialize_output_bitstream( BIT_STREAM *bs, uint8_t *stream,
+                                  long capacity )
+{
+    initialize_output_sink( bs, stream, capacity, NULL, NULL );
+}
 
-static int output_mask;                /* During output, this byte  */
-                                       /* contains the mask that is */
-                                       /* applied to the output byte*/
-                                       /* if the output bit is a 1  */
+/*
+ * Same as above, but the buffer is only a window that is handed to
+ * the sink every time it fills up.
+ */
+void initialize_output_sink( BIT_STREAM *bs, uint8_t *buffer, long capacity,
+                             BIT_SINK sink, void *opaque )
+{
+    bs->output = buffer;
+    bs->capacity = capacity;
+    bs->position = 0;
+    bs->flushed = 0;
+    bs->sink = sink;
+    bs->source = NULL;
+    bs->opaque = opaque;
+    bs->acc = 0;
+    bs->acc_bits = 0;
+    bs->error = 0;
+}
 
-static int input_bytes_left;           /* During input, these three */
-static int input_bits_left;            /* variables keep track of my*/
-static int past_eof;                   /* input state.  The past_eof*/
-                                       /* byte comes about because  */
-                                       /* of the fact that there is */
-                                       /* a possibility the decoder */
-                                       /* can legitimately ask for  */
-                                       /* more bits even after the  */
-                                       /* entire file has been      */
-                                       /* sucked dry.               */
+/*
+ * Hands the filled part of the buffer to the sink.  Without a sink
+ * there is nowhere for it to go, which is an overflow.  That is no
+ * fault of the stream: a block that does not compress overflows a
+ * buffer the size of the input, and the container stores it instead.
+ * So it is only flagged, and the caller decides whether it matters.
+ */
+static void drain_output( BIT_STREAM *bs )
+{
+    if ( bs->sink == NULL ||
+         bs->sink( bs->opaque, bs->output, bs->position ) != bs->position )
+    {
+        bs->error = 1;
+        return;
+    }
+    bs->flushed += bs->position;
+    bs->position = 0;
+}
 
+static void write_byte( BIT_STREAM *bs, uint8_t byte )
+{
+    if ( bs->position == bs->capacity )
+        drain_output( bs );
+    if ( bs->position < bs->capacity )
+        bs->output[ bs->position++ ] = byte;
+}
 
 /*
- * This routine is called once to initialze the output bitstream.
- * All it has to do is set up the current_byte pointer, clear out
- * all the bits in my current output byte, and set the output mask
- * so it will set the proper bit next time a bit is output.
+ * Called by put_bits() once 32 or more bits are pending.  The top 32
+ * of them are stored as one big endian word.  Once the stream has
+ * failed the bits are dropped, so the coders never have to check.
  */
-void initialize_output_bitstream()
+void spill_bitstream( BIT_STREAM *bs )
 {
-    current_byte = buffer;
-    *current_byte = 0;
-    output_mask = 0x80;
+    uint32_t word;
+    uint8_t *p;
+
+    bs->acc_bits -= 32;
+    word = (uint32_t) ( bs->acc >> bs->acc_bits );
+    if ( bs->position + 4 > bs->capacity )
+    {
+        write_byte( bs, (uint8_t) ( word >> 24 ) );
+        write_byte( bs, (uint8_t) ( word >> 16 ) );
+        write_byte( bs, (uint8_t) ( word >> 8 ) );
+        write_byte( bs, (uint8_t) word );
+        return;
+    }
+    p = bs->output + bs->position;
+    p[ 0 ] = (uint8_t) ( word >> 24 );
+    p[ 1 ] = (uint8_t) ( word >> 16 );
+    p[ 2 ] = (uint8_t) ( word >> 8 );
+    p[ 3 ] = (uint8_t) word;
+    bs->position += 4;
 }
 
 /*
- * The output bit routine just has to set a bit in the current byte
- * if requested to.  After that, it updates the mask.  If the mask
- * shows that the current byte is filled up, it is time to go to the
- * next character in the buffer.  If the next character is past the
- * end of the buffer, it is time to flush the buffer.
+ * When the encoding is done, there will still be some bits sitting
+ * in the accumulator.  They are written out, padded with zeros to a
+ * whole byte, and whatever is left in the buffer goes to the sink.
+ * The total number of bytes in the stream is returned, or -1 if it
+ * did not fit.
  */
-void output_bit( uint16_t *stream, int bit )
+long flush_output_bitstream( BIT_STREAM *bs )
 {
-    if ( bit )
-        *current_byte |= output_mask;
-    output_mask >>= 1;
-    if ( output_mask == 0 )
+    while ( bs->acc_bits >= 8 )
     {
-        output_mask = 0x80;
-        current_byte++;
-        if ( current_byte == ( buffer + BUFFER_SIZE ) )
-        {
-        	memcpy(stream, buffer, BUFFER_SIZE);
-            current_byte = buffer;
-        }
-        *current_byte = 0;
+        bs->acc_bits -= 8;
+        write_byte( bs, (uint8_t) ( bs->acc >> bs->acc_bits ) );
     }
+    if ( bs->acc_bits > 0 )
+        write_byte( bs, (uint8_t) ( bs->acc << ( 8 - bs->acc_bits ) ) );
+    bs->acc = 0;
+    bs->acc_bits = 0;
+    if ( bs->sink != NULL && bs->position > 0 && !bs->error )
+        drain_output( bs );
+    if ( bs->error )
+        return( -1 );
+    return( bs->flushed + bs->position );
 }
 
 /*
- * When the encoding is done, there will still be a lot of bits and
- * bytes sitting in the buffer waiting to be sent out.  This routine
- * is called to clean things up at that point.
+ * Input starts with an empty accumulator, so the first peek_bits()
+ * triggers a refill.  The whole stream is in the buffer.
  */
-void flush_output_bitstream( uint16_t *stream )
+void initialize_input_bitstream( BIT_STREAM *bs, const uint8_t *stream,
+                                 long length )
 {
-	uint8_t move_size = (current_byte - buffer < 3) ?
-			current_byte - buffer + 1 : 4;
-	memcpy(stream, buffer, (size_t)(move_size));
-    current_byte = buffer;
+    bs->input = stream;
+    bs->length = length;
+    bs->position = 0;
+    bs->flushed = 0;
+    bs->sink = NULL;
+    bs->source = NULL;
+    bs->opaque = NULL;
+    bs->acc = 0;
+    bs->acc_bits = 0;
+    bs->past_eof = 0;
+    bs->error = 0;
 }
 
 /*
- * Bit oriented input is set up so that the next time the input_bit
- * routine is called, it will trigger the read of a new block.  That
- * is why input_bits_left is set to 0.
+ * Same as above, but the buffer starts empty and is refilled from the
+ * source each time it has been read through.
  */
-void initialize_input_bitstream()
+void initialize_input_source( BIT_STREAM *bs, uint8_t *buffer, long capacity,
+                              BIT_SOURCE source, void *opaque )
 {
-    input_bits_left = 0;
-    input_bytes_left = 1;
-    past_eof = 0;
+    initialize_input_bitstream( bs, buffer, 0 );
+    bs->output = buffer;
+    bs->capacity = capacity;
+    bs->source = source;
+    bs->opaque = opaque;
 }
 
 /*
- * This routine reads bits in from a file.  The bits are all sitting
- * in a buffer, and this code pulls them out, one at a time.  When the
- * buffer has been emptied, that triggers a new file read, and the
- * pointers are reset.  This routine is set up to allow for two dummy
- * bytes to be read in after the end of file is reached.  This is because
- * we have to keep feeding bits into the pipeline to be decoded so that
- * the old stuff that is 16 bits upstream can be pushed out.
+ * Asks the source for the next window of input.  Returns 0 once the
+ * source has nothing more to give.
  */
-short int input_bit( uint16_t *stream )
+static int fetch_input( BIT_STREAM *bs )
 {
-    if ( input_bits_left == 0 )
+    long got;
+
+    got = bs->source( bs->opaque, bs->output, bs->capacity );
+    if ( got <= 0 )
+    {
+        bs->source = NULL;
+        return( 0 );
+    }
+    bs->flushed += bs->length;
+    bs->length = got;
+    bs->position = 0;
+    return( 1 );
+}
+
+/*
+ * Tops the accumulator up to at least 57 bits.  While there are 8
+ * bytes left in the buffer a whole word is loaded and as many bytes
+ * as fit are kept; the bits below the valid ones are the very bits
+ * the next load puts there, so or-ing them in again is harmless.
+ * Near the end of the buffer bytes are loaded one at a time, and
+ * the source, if any, is asked for more.  Zeros are fed past the end
+ * of the stream, because the decoders keep pulling bits in after the
+ * last symbol so the old stuff upstream can be pushed out.
+ */
+void refill_bitstream( BIT_STREAM *bs )
+{
+    const uint8_t *p;
+    uint64_t word;
+    int bytes;
+
+    for ( ; ; )
     {
-        current_byte++;
-        input_bytes_left--;
-        input_bits_left = 8;
-        if ( input_bytes_left == 0 )
+        if ( bs->position + 8 <= bs->length )
         {
-            input_bytes_left = *stream;//fread( buffer, 1, BUFFER_SIZE, stream );
-            if ( input_bytes_left == 0 )
-            {
-                if ( past_eof )
-                {
-                    fprintf( stderr, "Bad input file\n" );
-                    exit( -1 );
-                }
-                else
-                {
-                    past_eof = 1;
-                    input_bytes_left = 2;
-                }
-            }
-            current_byte = buffer;
+            p = bs->input + bs->position;
+            word = ( (uint64_t) p[ 0 ] << 56 ) | ( (uint64_t) p[ 1 ] << 48 ) |
+                   ( (uint64_t) p[ 2 ] << 40 ) | ( (uint64_t) p[ 3 ] << 32 ) |
+                   ( (uint64_t) p[ 4 ] << 24 ) | ( (uint64_t) p[ 5 ] << 16 ) |
+                   ( (uint64_t) p[ 6 ] << 8 )  |   (uint64_t) p[ 7 ];
+            bs->acc |= word >> bs->acc_bits;
+            bytes = ( 63 - bs->acc_bits ) >> 3;
+            bs->position += bytes;
+            bs->acc_bits += bytes << 3;
+            return;
         }
+        if ( bs->acc_bits > 56 )
+            return;
+        if ( bs->position < bs->length )
+            bs->acc |= (uint64_t) bs->input[ bs->position++ ]
+                       << ( 56 - bs->acc_bits );
+        else if ( bs->source != NULL && fetch_input( bs ) )
+            continue;
+        else if ( ++bs->past_eof > BITIO_EOF_SLACK && !bs->error )
+        {
+            fprintf( stderr, "Bad input file\n" );
+            bs->error = 1;
+        }
+        bs->acc_bits += 8;
     }
-    input_bits_left--;
-    return ( ( *current_byte >> input_bits_left ) & 1 );
+}
+
+/*
+ * These two routines report how many bytes have gone through a
+ * stream so far.
+ */
+long bit_ftell_output( BIT_STREAM *bs )
+{
+    return( bs->flushed + bs->position + ( bs->acc_bits + 7 ) / 8 );
+}
+
+long bit_ftell_input( BIT_STREAM *bs )
+{
+    return( bs->flushed + bs->position - bs->acc_bits / 8 );
 }
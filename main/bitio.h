@@ -27,14 +27,139 @@
  * Listing 3 -- bitio.h
  *
  * This header file contains the function prototypes needed to use
- * the bitstream i/o routines.
+ * the bitstream i/o routines.  All of the i/o state lives in a
+ * caller owned BIT_STREAM structure, so any number of streams can
+ * be active at the same time.
  *
+ * Bits are moved through a 64-bit accumulator.  put_bits(),
+ * peek_bits() and skip_bits() handle up to 32 bits per call and are
+ * inlined here; only the word sized refill and spill paths live in
+ * bitio.c.
+ *
+ * A stream works on a caller provided buffer of known capacity.  On
+ * its own the buffer has to hold the whole stream.  With a sink (or
+ * source) attached, the buffer is only a window: it is handed to the
+ * sink every time it fills up (or refilled from the source every
+ * time it runs dry), so streams of any length go through a bounded
+ * amount of RAM.
+ *
+ */
+
+#ifndef _BITIO_H_
+#define _BITIO_H_
+
+#include <stdint.h>
+
+#define BITIO_EOF_SLACK  12    /* Zero bytes fed past the end of the */
+                               /* input before it is flagged as bad  */
+
+/*
+ * A sink takes length bytes of finished output and returns how many
+ * it accepted; anything short of length is an error.  A source
+ * fills up to capacity bytes and returns how many it produced, 0 at
+ * the end of the stream.
+ */
+typedef long (*BIT_SINK)( void *opaque, const uint8_t *data, long length );
+typedef long (*BIT_SOURCE)( void *opaque, uint8_t *data, long capacity );
+
+/*
+ * The state of one bit oriented stream.  A stream is either used for
+ * output or for input, never both at once.  On output the pending
+ * bits sit at the bottom of the accumulator, on input the next bit
+ * to be read is its msb.
+ */
+typedef struct {
+                uint64_t acc;           /* Bit accumulator               */
+                int acc_bits;           /* Valid bits in the accumulator */
+                uint8_t *output;        /* Caller's output buffer        */
+                const uint8_t *input;   /* Caller's input buffer         */
+                long capacity;          /* Size of the output buffer     */
+                long length;            /* Bytes available in the input  */
+                long position;          /* Bytes written to / read from  */
+                                        /* the current buffer            */
+                long flushed;           /* Bytes that went through the   */
+                                        /* sink or source before it      */
+                BIT_SINK sink;          /* Optional drain for the output */
+                BIT_SOURCE source;      /* Optional feed for the input   */
+                void *opaque;           /* Passed to the sink or source  */
+                int past_eof;           /* Dummy bytes fed past the end  */
+                int error;              /* Set on overflow, a failed     */
+                                        /* sink or a read past the end   */
+               } BIT_STREAM;
+
+void initialize_output_bitstream( BIT_STREAM *bs, uint8_t *stream,
+                                  long capacity );
+void initialize_output_sink( BIT_STREAM *bs, uint8_t *buffer, long capacity,
+                             BIT_SINK sink, void *opaque );
+long flush_output_bitstream( BIT_STREAM *bs );
+void initialize_input_bitstream( BIT_STREAM *bs, const uint8_t *stream,
+                                 long length );
+void initialize_input_source( BIT_STREAM *bs, uint8_t *buffer, long capacity,
+                              BIT_SOURCE source, void *opaque );
+void spill_bitstream( BIT_STREAM *bs );
+void refill_bitstream( BIT_STREAM *bs );
+long bit_ftell_output( BIT_STREAM *bs );
+long bit_ftell_input( BIT_STREAM *bs );
+
+/*
+ * Appends the low n bits of value, msb first.  n may be 1 to 32.
  */
+static inline void put_bits( BIT_STREAM *bs, int n, uint32_t value )
+{
+    bs->acc = ( bs->acc << n ) | ( value & ( 0xffffffffUL >> ( 32 - n ) ) );
+    bs->acc_bits += n;
+    if ( bs->acc_bits >= 32 )
+        spill_bitstream( bs );
+}
+
+/*
+ * Returns the next n bits without consuming them.  n may be 1 to 32.
+ */
+static inline uint32_t peek_bits( BIT_STREAM *bs, int n )
+{
+    if ( bs->acc_bits < n )
+        refill_bitstream( bs );
+    return( (uint32_t) ( bs->acc >> ( 64 - n ) ) );
+}
+
+/*
+ * Consumes n bits that have already been peeked at.
+ */
+static inline void skip_bits( BIT_STREAM *bs, int n )
+{
+    bs->acc <<= n;
+    bs->acc_bits -= n;
+}
+
+static inline uint32_t get_bits( BIT_STREAM *bs, int n )
+{
+    uint32_t value = peek_bits( bs, n );
+
+    skip_bits( bs, n );
+    return( value );
+}
+
+/*
+ * The single bit and single byte entry points used by the coders.
+ */
+static inline void output_bit( BIT_STREAM *bs, int bit )
+{
+    put_bits( bs, 1, bit != 0 );
+}
+
+static inline short int input_bit( BIT_STREAM *bs )
+{
+    return( (short int) get_bits( bs, 1 ) );
+}
+
+static inline void output_byte( BIT_STREAM *bs, int byte )
+{
+    put_bits( bs, 8, (uint32_t) byte );
+}
+
+static inline int input_byte( BIT_STREAM *bs )
+{
+    return( (int) get_bits( bs, 8 ) );
+}
 
-short int input_bit( uint16_t *stream );
-void initialize_output_bitstream( void );
-void output_bit( uint16_t *stream, int bit );
-void flush_output_bitstream( uint16_t *stream );
-void initialize_input_bitstream( void );
-long bit_ftell_output( uint16_t *stream );
-long bit_ftell_input( uint16_t *stream );
+#endif  /* ndef _BITIO_H_ */
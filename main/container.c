@@ -0,0 +1,412 @@
+/***************************************************************************
+*                         Block Container Format
+*
+*   File    : container.c
+*   Purpose : Frames the output of the coders in self describing blocks
+*             and dispatches a block back to the decoder that wrote it.
+*             A block that would not come out smaller than its text is
+*             stored instead, so a block is never bigger than the text
+*             plus its header.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include "container.h"
+#include "crc32.h"
+#include "arith_coder.h"
+#include "lzw.h"
+#include "transform.h"
+#include "delta_codec.h"
+#include "memtrack.h"
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : StoreLE32 / LoadLE32
+*   Description: Write and read the little endian header fields.
+***************************************************************************/
+static void StoreLE32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t LoadLE32(const uint8_t *p)
+{
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/***************************************************************************
+*   Function   : ContainerBound
+*   Description: Worst case size of a block: a stored copy of the text.
+*   Parameters : length - number of chars of text
+*   Returned   : Bytes needed for the output buffer
+***************************************************************************/
+long ContainerBound(long length)
+{
+    return CONTAINER_HEADER_SIZE + length;
+}
+
+/***************************************************************************
+*   Function   : EncodePayload
+*   Description: Runs a codec on the text, writing at most capacity bytes.
+*   Parameters : codec - the CODEC_ id to run
+*                flags - CONTAINER_STRIPPED to drop the '.'s first
+*                format - CONTAINER_FORMAT() of the samples, 0 for none
+*                text - the text
+*                length - number of chars of text
+*                out - where the payload goes
+*                capacity - size of out in bytes
+*   Returned   : Number of bytes written, -1 if the codec failed or the
+*                payload did not fit.
+***************************************************************************/
+static long EncodePayload(int codec, int flags, int format,
+    const char *text, long length, uint8_t *out, long capacity)
+{
+    char *scratch = NULL;
+    int32_t *values;
+    int sampleLength = 0;
+    long count;
+    long outLen = -1;
+
+    if (format != 0)
+    {
+        sampleLength = CONTAINER_SAMPLE_LENGTH(format);
+    }
+
+    /* the text coders run up to a '\0', which the text may not have
+     * when it is a slice of a bigger buffer */
+    if ((codec == CODEC_ARITH) || (codec == CODEC_LZW))
+    {
+        scratch = MemAlloc(length + 1);
+
+        if (NULL == scratch)
+        {
+            return -1;
+        }
+
+        if (!(flags & CONTAINER_STRIPPED))
+        {
+            memcpy(scratch, text, length);
+            scratch[length] = '\0';
+        }
+        else if (TransformStrip(text, length, scratch,
+            CONTAINER_INTEGER(format), CONTAINER_DECIMAL(format)) >= 0)
+        {
+            sampleLength--;
+        }
+        else
+        {
+            MemFree(scratch);
+            return -1;
+        }
+
+        text = scratch;
+    }
+
+    switch (codec)
+    {
+        case CODEC_ARITH:
+            outLen = compress((char *)text, out, capacity, sampleLength);
+            break;
+
+        case CODEC_LZW:
+            outLen = LZWEncode((char *)text, out, capacity);
+            break;
+
+        case CODEC_DELTA:
+            if (format == 0)
+            {
+                break;
+            }
+
+            values = MemAlloc((length / sampleLength + 1) * sizeof(int32_t));
+
+            if (NULL == values)
+            {
+                break;
+            }
+
+            count = TransformParse(text, length, values,
+                CONTAINER_INTEGER(format), CONTAINER_DECIMAL(format));
+
+            if (count >= 0)
+            {
+                outLen = DeltaEncode(values, count, out, capacity);
+            }
+
+            MemFree(values);
+            break;
+    }
+
+    MemFree(scratch);
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : ContainerEncode
+*   Description: This routine codes a buffer of text with the requested
+*                codec and frames the result as a single block.  The
+*                models of every codec start fresh, so the block can be
+*                decoded on its own and carries CONTAINER_RESET.  If the
+*                codec cannot make the text smaller it is stored.
+*   Parameters : codec - the CODEC_ id to use
+*                flags - CONTAINER_STRIPPED to drop the '.'s before an
+*                        arithmetic or LZW pass, needs a format
+*                format - CONTAINER_FORMAT() of the samples, 0 if the
+*                         text has no fixed format
+*                text - the text to code
+*                length - number of chars of text
+*                out - where the block goes
+*                capacity - size of out, ContainerBound(length) is enough
+*   Effects    : The block is written to out
+*   Returned   : Size of the block in bytes, -1 for failure.
+***************************************************************************/
+long ContainerEncode(int codec, int flags, int format, const char *text,
+    long length, uint8_t *out, long capacity)
+{
+    long payloadLen = -1;
+    long room;
+
+    if ((NULL == text) || (NULL == out) || (length < 0) ||
+        (codec < 0) || (codec >= CODEC_COUNT) ||
+        ((format == 0) && (flags & CONTAINER_STRIPPED)) ||
+        (capacity < CONTAINER_HEADER_SIZE))
+    {
+        return -1;
+    }
+
+    /* the delta codec works on values, not text */
+    if ((codec == CODEC_STORED) || (codec == CODEC_DELTA))
+    {
+        flags &= ~CONTAINER_STRIPPED;
+    }
+
+    /* anything as big as the stored text is no use */
+    room = capacity - CONTAINER_HEADER_SIZE;
+
+    if (room > length)
+    {
+        room = length;
+    }
+
+    if ((codec != CODEC_STORED) && (length > 0))
+    {
+        payloadLen = EncodePayload(codec, flags, format, text, length,
+            out + CONTAINER_HEADER_SIZE, room);
+    }
+
+    if ((payloadLen < 0) || (payloadLen >= length))
+    {
+        if (capacity - CONTAINER_HEADER_SIZE < length)
+        {
+            return -1;
+        }
+
+        codec = CODEC_STORED;
+        flags &= ~CONTAINER_STRIPPED;
+        payloadLen = length;
+        memcpy(out + CONTAINER_HEADER_SIZE, text, length);
+    }
+
+    out[0] = CONTAINER_MAGIC;
+    out[1] = (uint8_t)codec;
+    out[2] = (uint8_t)(flags | CONTAINER_RESET);
+    out[3] = (uint8_t)format;
+    StoreLE32(out + 4, (uint32_t)length);
+    StoreLE32(out + 8, (uint32_t)payloadLen);
+    StoreLE32(out + 12,
+        Crc32(Crc32(0, out, 12), out + CONTAINER_HEADER_SIZE, payloadLen));
+
+    return CONTAINER_HEADER_SIZE + payloadLen;
+}
+
+/***************************************************************************
+*   Function   : ContainerParse
+*   Description: This routine reads a block header and checks that it is
+*                one this decoder understands and that its payload is
+*                within the buffer.  The payload is not looked at.
+*   Parameters : in - start of the block
+*                length - bytes available from in
+*                header - where the fields go
+*   Effects    : header is filled in
+*   Returned   : 0 if the header is well formed, -1 otherwise.
+***************************************************************************/
+int ContainerParse(const uint8_t *in, long length, block_header_t *header)
+{
+    if ((NULL == in) || (length < CONTAINER_HEADER_SIZE) ||
+        (in[0] != CONTAINER_MAGIC))
+    {
+        return -1;
+    }
+
+    header->codec = in[1];
+    header->flags = in[2];
+    header->format = in[3];
+    header->originalLength = LoadLE32(in + 4);
+    header->payloadLength = LoadLE32(in + 8);
+    header->crc = LoadLE32(in + 12);
+
+    if ((header->codec >= CODEC_COUNT) ||
+        (header->payloadLength > (uint32_t)(length - CONTAINER_HEADER_SIZE)))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ContainerVerify
+*   Description: This routine checks the CRC of a parsed block.
+*   Parameters : in - start of the block
+*                header - the header ContainerParse read from in
+*   Effects    : None
+*   Returned   : 0 if the block is intact, -1 otherwise.
+***************************************************************************/
+int ContainerVerify(const uint8_t *in, const block_header_t *header)
+{
+    uint32_t crc;
+
+    crc = Crc32(Crc32(0, in, 12), in + CONTAINER_HEADER_SIZE,
+        header->payloadLength);
+
+    return (crc == header->crc) ? 0 : -1;
+}
+
+/***************************************************************************
+*   Function   : ContainerDecode
+*   Description: This routine checks a block and hands its payload to the
+*                decoder named in the header.  Blocks that continue the
+*                models of an earlier block are not supported.
+*   Parameters : in - start of the block
+*                length - bytes available from in
+*                out - where the text goes
+*                capacity - size of out in bytes
+*   Effects    : The text of the block is written to out, '\0'
+*                terminated when there is room.
+*   Returned   : Number of chars written, -1 if the block is corrupt or
+*                the text does not fit.
+***************************************************************************/
+long ContainerDecode(const uint8_t *in, long length, char *out,
+    long capacity)
+{
+    block_header_t header;
+    const uint8_t *payload;
+    char *scratch = NULL;
+    char *text = out;
+    long textCapacity = capacity;
+    int32_t *values;
+    int sampleLength = 0;
+    long count;
+    long outLen = -1;
+
+    if ((NULL == out) || (ContainerParse(in, length, &header) != 0) ||
+        (ContainerVerify(in, &header) != 0) ||
+        !(header.flags & CONTAINER_RESET) ||
+        (header.originalLength > (uint32_t)capacity))
+    {
+        return -1;
+    }
+
+    payload = in + CONTAINER_HEADER_SIZE;
+
+    if (header.format != 0)
+    {
+        sampleLength = CONTAINER_SAMPLE_LENGTH(header.format);
+    }
+
+    if (header.flags & CONTAINER_STRIPPED)
+    {
+        if (header.format == 0)
+        {
+            return -1;
+        }
+
+        scratch = MemAlloc(header.originalLength + 1);
+
+        if (NULL == scratch)
+        {
+            return -1;
+        }
+
+        text = scratch;
+        textCapacity = header.originalLength + 1;
+        sampleLength--;
+    }
+
+    switch (header.codec)
+    {
+        case CODEC_STORED:
+            if (header.payloadLength == header.originalLength)
+            {
+                outLen = header.payloadLength;
+                memcpy(text, payload, outLen);
+            }
+            break;
+
+        case CODEC_ARITH:
+            outLen = expand(payload, header.payloadLength, text,
+                textCapacity, sampleLength);
+            break;
+
+        case CODEC_LZW:
+            outLen = LZWDecode(payload, header.payloadLength, text,
+                textCapacity);
+            break;
+
+        case CODEC_DELTA:
+            if ((header.format == 0) || (text != out))
+            {
+                break;
+            }
+
+            count = header.originalLength / sampleLength;
+            values = MemAlloc((count + 1) * sizeof(int32_t));
+
+            if (NULL == values)
+            {
+                break;
+            }
+
+            count = DeltaDecode(payload, header.payloadLength, values, count);
+
+            if (count >= 0)
+            {
+                outLen = TransformFormat(values, count, out, capacity,
+                    CONTAINER_INTEGER(header.format),
+                    CONTAINER_DECIMAL(header.format));
+            }
+
+            MemFree(values);
+            break;
+    }
+
+    if ((outLen >= 0) && (scratch != NULL))
+    {
+        outLen = TransformRestore(scratch, outLen, out, capacity,
+            CONTAINER_INTEGER(header.format), CONTAINER_DECIMAL(header.format));
+    }
+
+    MemFree(scratch);
+
+    if (outLen != (long)header.originalLength)
+    {
+        return -1;
+    }
+
+    if (outLen < capacity)
+    {
+        out[outLen] = '\0';
+    }
+
+    return outLen;
+}
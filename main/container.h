@@ -0,0 +1,92 @@
+/***************************************************************************
+*                         Block Container Format
+*
+*   File    : container.h
+*   Purpose : Provides the layout and prototypes of the self describing
+*             blocks the coders' output is framed in.  A block is a
+*             CONTAINER_HEADER_SIZE byte header followed by the payload
+*             of the codec it names:
+*
+*               0      magic, CONTAINER_MAGIC
+*               1      codec id, one of the CODEC_ values
+*               2      flags, CONTAINER_ bits
+*               3      sample format, integer digits in the high nibble
+*                      and decimal digits in the low one, 0 for text
+*                      without a fixed format
+*               4..7   original length in chars, little endian
+*               8..11  payload length in bytes, little endian
+*               12..15 CRC-32 of bytes 0 to 11 and the payload
+*
+*             A receiver can check a block and pick its decoder from the
+*             header alone, and step over a corrupt one using the
+*             payload length.
+*
+***************************************************************************/
+
+#ifndef _CONTAINER_H_
+#define _CONTAINER_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+#include "schema.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define CONTAINER_HEADER_SIZE   16
+#define CONTAINER_MAGIC         0xC5
+
+/* codec ids */
+#define CODEC_STORED    0       /* payload is the text itself */
+#define CODEC_ARITH     1       /* compress() */
+#define CODEC_LZW       2       /* LZWEncode() */
+#define CODEC_DELTA     3       /* DeltaEncode() of the parsed samples */
+#define CODEC_COUNT     4
+
+/* flags */
+#define CONTAINER_RESET     0x01    /* models start fresh in this block */
+#define CONTAINER_STRIPPED  0x02    /* the '.'s were dropped before coding */
+
+#define CONTAINER_FORMAT(integerDigits, decimalDigits) \
+    (((integerDigits) << 4) | (decimalDigits))
+#define CONTAINER_INTEGER(format)   ((format) >> 4)
+#define CONTAINER_DECIMAL(format)   ((format) & 0x0F)
+#define CONTAINER_SAMPLE_LENGTH(format) \
+    SCHEMA_SAMPLE_CHARS(CONTAINER_INTEGER(format), CONTAINER_DECIMAL(format))
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    uint8_t codec;              /* codec that wrote the payload */
+    uint8_t flags;              /* CONTAINER_ flags */
+    uint8_t format;             /* CONTAINER_FORMAT() of the samples */
+    uint32_t originalLength;    /* chars of text in the block */
+    uint32_t payloadLength;     /* bytes following the header */
+    uint32_t crc;               /* CRC-32 of header and payload */
+} block_header_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* largest block ContainerEncode can produce for length chars */
+long ContainerBound(long length);
+
+/* code length chars of text into a block, returns its size or -1 */
+long ContainerEncode(int codec, int flags, int format, const char *text,
+    long length, uint8_t *out, long capacity);
+
+/* read a block header, returns 0 if it is well formed or -1 */
+int ContainerParse(const uint8_t *in, long length, block_header_t *header);
+
+/* check a parsed block's CRC, returns 0 if it matches or -1 */
+int ContainerVerify(const uint8_t *in, const block_header_t *header);
+
+/* decode a block, returns the number of chars written or -1 */
+long ContainerDecode(const uint8_t *in, long length, char *out,
+    long capacity);
+
+#endif  /* ndef _CONTAINER_H_ */
@@ -0,0 +1,325 @@
+/***************************************************************************
+*                         Benchmark Sample Corpus
+*
+*   File    : corpus.c
+*   Purpose : Seeded generators for the shapes of data the coders meet,
+*             from uniform noise, the worst case for all of them, to the
+*             smooth and flat signals real sensors produce, plus loading
+*             recorded traces.  The random numbers come from xorshift64*
+*             seeded through splitmix64, which is fast, has no bad seeds
+*             and gives the same sequence on every platform.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "corpus.h"
+#include "transform.h"
+#include "schema.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define WALK_STEP       500     /* walk steps are up to range / this */
+#define SINE_PERIOD     1000    /* samples per sine cycle */
+#define SINE_NOISE      100     /* noise is up to range / this */
+#define PIECE_LENGTH    256     /* longest stretch at one level */
+#define TRACE_LINE      64      /* longest line in a trace file */
+
+#ifndef M_PI
+#define M_PI            3.14159265358979323846
+#endif
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : CorpusSeed
+*   Description: Starts a generator.  splitmix64 spreads the seed over
+*                the whole state and never gives the all zero state
+*                xorshift cannot leave.
+***************************************************************************/
+void CorpusSeed(corpus_rng_t *rng, uint64_t seed)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    rng->state = (z != 0) ? z : 1;
+}
+
+/***************************************************************************
+*   Function   : CorpusNext
+*   Description: One step of xorshift64*, the high half of the product
+*                is the best mixed so it is what is returned.
+***************************************************************************/
+uint32_t CorpusNext(corpus_rng_t *rng)
+{
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+
+    return (uint32_t)((rng->state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/***************************************************************************
+*   Function   : CorpusBelow
+*   Description: Uniform value below bound by the multiply and shift
+*                method.  The bias is under bound / 2^32, far too small
+*                to matter for benchmark data.
+***************************************************************************/
+uint32_t CorpusBelow(corpus_rng_t *rng, uint32_t bound)
+{
+    return (uint32_t)(((uint64_t)CorpusNext(rng) * bound) >> 32);
+}
+
+/***************************************************************************
+*   Function   : CorpusName
+*   Description: Name of a corpus kind for reports.
+***************************************************************************/
+const char *CorpusName(int kind)
+{
+    static const char *names[CORPUS_TRACE + 1] =
+        {"uniform", "random_walk", "sine_noise", "piecewise", "trace"};
+
+    return ((kind >= 0) && (kind <= CORPUS_TRACE)) ? names[kind] : "unknown";
+}
+
+/***************************************************************************
+*   Function   : Range
+*   Description: Number of values a sample format can hold, 10^digits.
+***************************************************************************/
+static int32_t Range(int integerDigits, int decimalDigits)
+{
+    int32_t range = 1;
+    int i;
+
+    for (i = 0; i < integerDigits + decimalDigits; i++)
+    {
+        range *= 10;
+    }
+
+    return range;
+}
+
+/***************************************************************************
+*   Function   : Lowest
+*   Description: Smallest value of a format of the given range, 0, or
+*                -(range - 1) with a signed schema.
+***************************************************************************/
+static int32_t Lowest(int32_t range)
+{
+    return SCHEMA_SIGNED ? 1 - range : 0;
+}
+
+/***************************************************************************
+*   Function   : Clamp
+*   Description: Keeps a value inside Lowest(range) .. range - 1.
+***************************************************************************/
+static int32_t Clamp(long value, int32_t range)
+{
+    if (value < Lowest(range))
+    {
+        return Lowest(range);
+    }
+
+    return (value >= range) ? range - 1 : (int32_t)value;
+}
+
+/***************************************************************************
+*   Function   : CorpusGenerate
+*   Description: This routine fills values with count samples of the
+*                given kind.  With a signed schema they span negative
+*                values too, centred on 0 rather than on the middle of
+*                the positive range.
+*   Parameters : kind - one of the CORPUS_ kinds
+*                seed - seed for the random numbers
+*                values - where the samples go
+*                count - number of samples
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : values is filled in
+*   Returned   : count, -1 for an unknown kind or a format too wide for
+*                32 bit values.
+***************************************************************************/
+long CorpusGenerate(int kind, uint64_t seed, int32_t *values, long count,
+    int integerDigits, int decimalDigits)
+{
+    corpus_rng_t rng;
+    int32_t range;
+    int32_t lowest;
+    int32_t span;               /* number of values in the format */
+    int32_t step;
+    int32_t level;
+    long noise;
+    long hold = 0;
+    long value;
+    long i;
+
+    if ((NULL == values) || (count < 0) || (integerDigits < 0) ||
+        (decimalDigits < 0) || (integerDigits + decimalDigits < 1) ||
+        (integerDigits + decimalDigits > 9))
+    {
+        return -1;
+    }
+
+    CorpusSeed(&rng, seed);
+    range = Range(integerDigits, decimalDigits);
+    lowest = Lowest(range);
+    span = range - lowest;
+    value = (range + lowest) / 2;
+    level = value;
+
+    for (i = 0; i < count; i++)
+    {
+        switch (kind)
+        {
+            case CORPUS_UNIFORM:
+                values[i] = lowest + (int32_t)CorpusBelow(&rng, span);
+                break;
+
+            case CORPUS_RANDOM_WALK:
+                step = range / WALK_STEP + 1;
+                value += (long)CorpusBelow(&rng, 2 * step + 1) - step;
+                value = Clamp(value, range);
+                values[i] = value;
+                break;
+
+            case CORPUS_SINE_NOISE:
+                noise = range / SINE_NOISE + 1;
+                value = (long)(((range + lowest) / 2) +
+                    (span * 0.4) * sin((2 * M_PI * i) / SINE_PERIOD));
+                value += (long)CorpusBelow(&rng, 2 * noise + 1) - noise;
+                values[i] = Clamp(value, range);
+                break;
+
+            case CORPUS_PIECEWISE:
+                if (hold == 0)
+                {
+                    level = lowest + (int32_t)CorpusBelow(&rng, span);
+                    hold = CorpusBelow(&rng, PIECE_LENGTH) + 1;
+                }
+
+                values[i] = level;
+                hold--;
+                break;
+
+            default:
+                return -1;
+        }
+    }
+
+    return count;
+}
+
+/***************************************************************************
+*   Function   : CorpusText
+*   Description: This routine generates samples like CorpusGenerate and
+*                writes them out as fixed format text, the input the
+*                text coders take.
+*   Parameters : kind - one of the CORPUS_ kinds
+*                seed - seed for the random numbers
+*                out - where the text goes
+*                capacity - size of out in bytes
+*                count - number of samples
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : The text is written to out, '\0' terminated when there
+*                is room.
+*   Returned   : Number of chars written, -1 for failure.
+***************************************************************************/
+long CorpusText(int kind, uint64_t seed, char *out, long capacity,
+    long count, int integerDigits, int decimalDigits)
+{
+    int32_t *values;
+    long outLen = -1;
+
+    values = malloc((count + 1) * sizeof(int32_t));
+
+    if (NULL == values)
+    {
+        return -1;
+    }
+
+    if (CorpusGenerate(kind, seed, values, count, integerDigits,
+        decimalDigits) == count)
+    {
+        outLen = TransformFormat(values, count, out, capacity,
+            integerDigits, decimalDigits);
+    }
+
+    free(values);
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : CorpusLoadTrace
+*   Description: This routine reads a recorded trace, one reading per
+*                line in any format strtod takes, and converts each one
+*                to the fixed point format, rounding and clamping to its
+*                range, negative values included with a signed schema.  Lines that are not numbers are skipped, so
+*                headers and comments do no harm.
+*   Parameters : path - the trace file
+*                values - where the samples go
+*                capacity - most samples to read
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : values is filled in
+*   Returned   : Number of samples read, -1 if the file cannot be opened.
+***************************************************************************/
+long CorpusLoadTrace(const char *path, int32_t *values, long capacity,
+    int integerDigits, int decimalDigits)
+{
+    FILE *fp;
+    char line[TRACE_LINE];
+    char *end;
+    double reading;
+    double scale;
+    int32_t range;
+    long count = 0;
+    int c;
+
+    if ((NULL == path) || (NULL == values) ||
+        (integerDigits + decimalDigits > 9))
+    {
+        return -1;
+    }
+
+    fp = fopen(path, "r");
+
+    if (NULL == fp)
+    {
+        perror("Opening trace");
+        return -1;
+    }
+
+    range = Range(integerDigits, decimalDigits);
+    scale = Range(0, decimalDigits);
+
+    while ((count < capacity) && (fgets(line, sizeof(line), fp) != NULL))
+    {
+        /* drop the rest of an overlong line */
+        if ((strchr(line, '\n') == NULL) && !feof(fp))
+        {
+            while (((c = fgetc(fp)) != EOF) && (c != '\n'))
+            {
+            }
+        }
+
+        reading = strtod(line, &end);
+
+        if (end == line)
+        {
+            continue;
+        }
+
+        values[count++] = Clamp(lround(reading * scale), range);
+    }
+
+    fclose(fp);
+    return count;
+}
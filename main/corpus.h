@@ -0,0 +1,72 @@
+/***************************************************************************
+*                         Benchmark Sample Corpus
+*
+*   File    : corpus.h
+*   Purpose : Provides prototypes for generating repeatable benchmark
+*             input.  Every generator draws from its own seeded random
+*             number generator, so the same kind, seed and count give
+*             the same samples on every run.  Only the sine goes through
+*             floating point, so only it can differ by a count from one
+*             C library to another.  The samples are fixed point values
+*             in the range of the sample format, 0 to
+*             10^(integerDigits + decimalDigits) - 1, or from
+*             -(10^(integerDigits + decimalDigits) - 1) with a signed
+*             schema.
+*
+***************************************************************************/
+
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define CORPUS_UNIFORM      0   /* independent uniform values */
+#define CORPUS_RANDOM_WALK  1   /* small random steps from the middle */
+#define CORPUS_SINE_NOISE   2   /* a slow sine plus a little noise */
+#define CORPUS_PIECEWISE    3   /* levels held for random stretches */
+#define CORPUS_KINDS        4   /* number of generated kinds */
+#define CORPUS_TRACE        4   /* a recorded trace, see CorpusLoadTrace */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    uint64_t state;
+} corpus_rng_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* start a generator, every seed including 0 is fine */
+void CorpusSeed(corpus_rng_t *rng, uint64_t seed);
+
+/* next 32 random bits */
+uint32_t CorpusNext(corpus_rng_t *rng);
+
+/* uniform value in 0 .. bound - 1 */
+uint32_t CorpusBelow(corpus_rng_t *rng, uint32_t bound);
+
+/* name of a corpus kind for reports */
+const char *CorpusName(int kind);
+
+/* fill count values of a kind, returns count or -1 */
+long CorpusGenerate(int kind, uint64_t seed, int32_t *values, long count,
+    int integerDigits, int decimalDigits);
+
+/* the same as text samples, returns the chars written or -1 */
+long CorpusText(int kind, uint64_t seed, char *out, long capacity,
+    long count, int integerDigits, int decimalDigits);
+
+/* read up to capacity values from a trace file, one number per line,
+ * returns the count or -1 */
+long CorpusLoadTrace(const char *path, int32_t *values, long capacity,
+    int integerDigits, int decimalDigits);
+
+#endif  /* ndef _CORPUS_H_ */
@@ -0,0 +1,25 @@
+/***************************************************************************
+*                        CRC-32 Checksum Functions
+*
+*   File    : crc32.h
+*   Purpose : Provides a prototype for the CRC-32 that protects the
+*             blocks of the container format.
+*
+***************************************************************************/
+
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* CRC-32 of data continuing from crc, start with crc = 0 */
+uint32_t Crc32(uint32_t crc, const void *data, size_t length);
+
+#endif  /* ndef _CRC32_H_ */
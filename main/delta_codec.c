@@ -0,0 +1,259 @@
+/***************************************************************************
+*                  Delta + Zigzag + Bit Packing Sample Codec
+*
+*   File    : delta_codec.c
+*   Purpose : Codes slowly varying fixed point samples.  Differences of
+*             neighbouring samples are small, so after the zigzag map
+*             most blocks pack into a few bits per sample.  Unpacking a
+*             block is a straight loop of load, shift and mask with no
+*             data dependent branches.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include "delta_codec.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define HEADER_SIZE     4       /* bytes for the value count */
+#define MAX_BLOCK_BYTES (DELTA_BLOCK * 4)
+
+/***************************************************************************
+*                                  MACROS
+***************************************************************************/
+#define ZIGZAG(r)       (((uint32_t)(r) << 1) ^ (uint32_t)((int32_t)(r) >> 31))
+#define UNZIGZAG(z)     (((z) >> 1) ^ (0 - ((z) & 1)))
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LoadLE64
+*   Description: Reads 8 bytes as a little endian word.  Compilers turn
+*                this into a single load on little endian targets.
+***************************************************************************/
+static uint64_t LoadLE64(const uint8_t *p)
+{
+    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) |
+        ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+        ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+        ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/***************************************************************************
+*   Function   : BitWidth
+*   Description: Number of bits needed to hold value.
+***************************************************************************/
+static int BitWidth(uint32_t value)
+{
+    int width = 0;
+
+    while (value != 0)
+    {
+        width++;
+        value >>= 1;
+    }
+
+    return width;
+}
+
+/***************************************************************************
+*   Function   : DeltaCompressBound
+*   Description: Worst case size of an encoded stream: the header, and
+*                for every block a width byte plus 32 bits per value.
+*   Parameters : count - number of values
+*   Returned   : Bytes needed for the output buffer
+***************************************************************************/
+long DeltaCompressBound(long count)
+{
+    return HEADER_SIZE + ((count + DELTA_BLOCK - 1) / DELTA_BLOCK) +
+        (count * 4);
+}
+
+/***************************************************************************
+*   Function   : DeltaEncode
+*   Description: This routine delta codes, zigzag maps and bit packs an
+*                array of values.
+*   Parameters : values - the samples to encode
+*                count - number of samples
+*                out - buffer for the encoded stream
+*                capacity - size of out
+*   Effects    : The stream is written to out
+*   Returned   : Number of bytes written, -1 if they do not fit.
+***************************************************************************/
+long DeltaEncode(const int32_t *values, long count, uint8_t *out,
+    long capacity)
+{
+    uint32_t residuals[DELTA_BLOCK];
+    uint32_t prev = 0;
+    uint32_t bits;
+    uint64_t acc;
+    int accBits;
+    int blockLen;
+    int width;
+    long outLen;
+    long i;
+    int j;
+
+    if ((count < 0) || (count > 0xffffffffL) || (capacity < HEADER_SIZE))
+    {
+        return -1;
+    }
+
+    out[0] = (uint8_t)count;
+    out[1] = (uint8_t)(count >> 8);
+    out[2] = (uint8_t)(count >> 16);
+    out[3] = (uint8_t)(count >> 24);
+    outLen = HEADER_SIZE;
+
+    for (i = 0; i < count; i += DELTA_BLOCK)
+    {
+        blockLen = (count - i < DELTA_BLOCK) ? (int)(count - i) : DELTA_BLOCK;
+
+        /* residuals of this block and the width that holds them all */
+        bits = 0;
+
+        for (j = 0; j < blockLen; j++)
+        {
+            residuals[j] = ZIGZAG((uint32_t)values[i + j] - prev);
+            prev = (uint32_t)values[i + j];
+            bits |= residuals[j];
+        }
+
+        width = BitWidth(bits);
+
+        if (outLen + 1 + ((blockLen * width + 7) / 8) > capacity)
+        {
+            return -1;
+        }
+
+        out[outLen++] = (uint8_t)width;
+
+        /* pack lsb first */
+        acc = 0;
+        accBits = 0;
+
+        for (j = 0; j < blockLen; j++)
+        {
+            acc |= (uint64_t)residuals[j] << accBits;
+            accBits += width;
+
+            while (accBits >= 8)
+            {
+                out[outLen++] = (uint8_t)acc;
+                acc >>= 8;
+                accBits -= 8;
+            }
+        }
+
+        if (accBits > 0)
+        {
+            out[outLen++] = (uint8_t)acc;
+        }
+    }
+
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : DeltaDecode
+*   Description: This routine is the inverse of DeltaEncode.  Every
+*                residual is pulled out of the block with one unaligned
+*                8 byte load, a shift and a mask; the last block of the
+*                stream is copied to a padded buffer first so those loads
+*                never run off the end of the input.
+*   Parameters : in - the encoded stream
+*                length - number of bytes in
+*                values - buffer for the decoded samples
+*                capacity - number of values that fit in values
+*   Effects    : The samples are written to values
+*   Returned   : Number of samples decoded, -1 for a corrupt stream or a
+*                full buffer.
+***************************************************************************/
+long DeltaDecode(const uint8_t *in, long length, int32_t *values,
+    long capacity)
+{
+    uint8_t padded[MAX_BLOCK_BYTES + 8];
+    uint32_t residuals[DELTA_BLOCK];
+    const uint8_t *block;
+    uint32_t prev = 0;
+    uint64_t mask;
+    unsigned long count;
+    unsigned long bitPos;
+    long inPos;
+    long blockBytes;
+    int blockLen;
+    int width;
+    long i;
+    int j;
+
+    if (length < HEADER_SIZE)
+    {
+        return -1;
+    }
+
+    count = (unsigned long)in[0] | ((unsigned long)in[1] << 8) |
+        ((unsigned long)in[2] << 16) | ((unsigned long)in[3] << 24);
+
+    if (count > (unsigned long)capacity)
+    {
+        return -1;
+    }
+
+    inPos = HEADER_SIZE;
+
+    for (i = 0; i < (long)count; i += DELTA_BLOCK)
+    {
+        blockLen = ((long)count - i < DELTA_BLOCK) ?
+            (int)(count - i) : DELTA_BLOCK;
+
+        if (inPos >= length)
+        {
+            return -1;
+        }
+
+        width = in[inPos++];
+        blockBytes = (blockLen * width + 7) / 8;
+
+        if ((width > 32) || (inPos + blockBytes > length))
+        {
+            return -1;
+        }
+
+        block = in + inPos;
+
+        if (inPos + blockBytes + 8 > length)
+        {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, block, blockBytes);
+            block = padded;
+        }
+
+        inPos += blockBytes;
+
+        /* unpack */
+        mask = ((uint64_t)1 << width) - 1;
+
+        for (j = 0; j < blockLen; j++)
+        {
+            bitPos = (unsigned long)j * width;
+            residuals[j] =
+                (uint32_t)((LoadLE64(block + (bitPos >> 3)) >> (bitPos & 7))
+                & mask);
+        }
+
+        /* undo the zigzag map and the deltas */
+        for (j = 0; j < blockLen; j++)
+        {
+            prev += UNZIGZAG(residuals[j]);
+            values[i + j] = (int32_t)prev;
+        }
+    }
+
+    return (long)count;
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+*                  Delta + Zigzag + Bit Packing Sample Codec
+*
+*   File    : delta_codec.h
+*   Purpose : Provides prototypes for the numeric sample codec.  Each
+*             value is replaced by its difference from the previous one,
+*             the signed differences are zigzag mapped to small unsigned
+*             numbers, and blocks of DELTA_BLOCK of them are packed with
+*             just enough bits for the largest one in the block.
+*
+*             Stream layout: the value count as 4 bytes, little endian,
+*             then for every block a byte with its bit width followed by
+*             the packed residuals, lsb first.
+*
+***************************************************************************/
+
+#ifndef _DELTA_CODEC_H_
+#define _DELTA_CODEC_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DELTA_BLOCK     64      /* residuals sharing one bit width */
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* largest stream DeltaEncode can produce for count values */
+long DeltaCompressBound(long count);
+
+/* encode values, returns the number of bytes written or -1 */
+long DeltaEncode(const int32_t *values, long count, uint8_t *out,
+    long capacity);
+
+/* decode a stream, returns the number of values or -1 */
+long DeltaDecode(const uint8_t *in, long length, int32_t *values,
+    long capacity);
+
+#endif  /* ndef _DELTA_CODEC_H_ */
@@ -37,25 +37,47 @@
 *                             INCLUDED FILES
 ***************************************************************************/
 #include <stdio.h>
+#include <stdint.h>
 #include <limits.h>
+#include "schema.h"
 
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
-#define MIN_CODE_LEN   	8                   /* min # bits in a coded word */
-#define MAX_CODE_LEN    256                /* max # bits in a code word */
-#define MIN_DECODE_LEN  9                   /* min # bits in a decode word */
-#define MAX_DECODE_LEN  14                  /* max # bits in a code word */
-
-#define INIT_CODE		11
-#define FIRST_CODE      256     /* value of 1st string code */
-#define MAX_CODES       (1 << MAX_CODE_LEN)
+#define MIN_DECODE_LEN  5                   /* min # bits in a code word */
+#define MAX_DECODE_LEN  12                  /* max # bits in a code word */
+
+#define LZW_SYMBOLS     SCHEMA_SYMBOLS  /* the alphabet's chars come first */
+#define END_CODE        (LZW_SYMBOLS)       /* marks the end of the code stream */
+#define CLEAR_CODE      (LZW_SYMBOLS + 1)   /* tells the decoder to reset */
+#define FIRST_CODE      (LZW_SYMBOLS + 2)   /* value of 1st string code */
 #define MAX_DECODES       (1 << MAX_DECODE_LEN)
 
+/* The byte mode codes any bytes, not just the alphabet.  Only the
+ * control codes are there from the start.  A byte's first appearance
+ * is sent as LZW_BYTE_ESCAPE and its 8 bits, and the byte gets the
+ * next free code like any other string. */
+#define LZW_BYTE_END        0           /* marks the end of the code stream */
+#define LZW_BYTE_CLEAR      1           /* tells the decoder to reset */
+#define LZW_BYTE_ESCAPE     2           /* a new byte follows */
+#define LZW_BYTE_FIRST      3           /* value of 1st byte or string code */
+#define LZW_BYTE_MIN_LEN    2           /* min # bits in a byte mode code */
+
+/* With LZW_MONITOR_RATIO set, a full dictionary is kept for as long as
+ * the compression ratio since the last reset keeps improving, checked
+ * every LZW_CHECK_GAP input chars.  Otherwise it is cleared as soon as
+ * it fills up. */
+#define LZW_MONITOR_RATIO   1
+#define LZW_CHECK_GAP       1024
+
 #define DEBUG		0
 
-#if (MIN_DECODE_LEN <= CHAR_BIT)
-#error Code words must be larger than 1 character
+#if ((1 << MIN_DECODE_LEN) <= FIRST_CODE)
+#error Code words must be large enough for every symbol and control code
+#endif
+
+#if ((1 << LZW_BYTE_MIN_LEN) < LZW_BYTE_FIRST)
+#error Byte mode code words must be large enough for every control code
 #endif
 
 #if ((MAX_DECODES - 1) > INT_MAX)
@@ -65,16 +87,41 @@
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
-#define CURRENT_MAX_CODES(bits)     ((unsigned int)(1 << (bits)))
 #define CURRENT_MAX_DECODES(bits)     ((unsigned int)(1 << (bits)))
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
- /* encode inFile */
-int LZWEncode(char* fpIn, int8_t* fpOut);
+ /* encode inFile, returns the number of bytes written or -1 */
+long LZWEncode(char* fpIn, uint8_t* fpOut, long capacity);
+
+/* decode inFile, returns the number of chars decoded or -1 */
+long LZWDecode(const uint8_t* fpIn, long length, char *fpOut, long capacity);
+
+/* the same without any allocation, the dictionary goes in the caller's
+ * workspace of the given size */
+long LZWEncodeWorkspaceSize(void);
+long LZWDecodeWorkspaceSize(void);
+long LZWEncodeWs(const char* fpIn, uint8_t* fpOut, long capacity,
+    void *workspace, long workspaceSize);
+long LZWDecodeWs(const uint8_t* fpIn, long length, char *fpOut,
+    long capacity, void *workspace, long workspaceSize);
+
+/* bytes of output that are always enough to encode length chars */
+long LZWEncodeBound(long length);
 
-/* decode inFile*/
-int LZWDecode(int8_t* fpIn, char *fpOut);
+/* byte mode versions, for length bytes of any values.  The decoded
+ * output is not '\0' terminated. */
+long LZWEncodeBytes(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity);
+long LZWDecodeBytes(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity);
+long LZWEncodeBytesWorkspaceSize(void);
+long LZWDecodeBytesWorkspaceSize(void);
+long LZWEncodeBytesWs(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity, void *workspace, long workspaceSize);
+long LZWDecodeBytesWs(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity, void *workspace, long workspaceSize);
+long LZWEncodeBytesBound(long length);
 
 
 #endif  /* ndef _LZW_H_ */
@@ -34,16 +34,21 @@
 *                             INCLUDED FILES
 ***************************************************************************/
 #include <stdio.h>
+#include <stdint.h>
 #include <errno.h>
 #include "lzw.h"
+#include "bitio.h"
+#include "memtrack.h"
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
 typedef struct
 {
+    uint16_t prefixCode;        /* code for remaining chars in string */
+    uint16_t length;            /* number of chars in the string */
     unsigned char suffixChar;   /* last char in encoded string */
-    unsigned int prefixCode;    /* code for remaining chars in string */
+    unsigned char firstChar;    /* first char in encoded string */
 } decode_dictionary_t;
 
 /***************************************************************************
@@ -58,169 +63,443 @@ typedef struct
 *                            GLOBAL VARIABLES
 ***************************************************************************/
 
-/* dictionary of string the code word is the dictionary index */
-static decode_dictionary_t dictionary[(MAX_DECODES - FIRST_CODE)];
-
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
-static unsigned char DecodeRecursive(int code, char **fpOut);
-int checkErrors(char in, char out);
+static int WriteString(const decode_dictionary_t *dictionary,
+    unsigned int code, char *fpOut);
 
-extern uint8_t stop;
+static int WriteBytes(const decode_dictionary_t *dictionary,
+    unsigned int code, uint8_t *fpOut);
 /***************************************************************************
 *                                FUNCTIONS
 ***************************************************************************/
 
 /***************************************************************************
-*   Function   : LZWDecodeFile
+*   Function   : LZWDecodeWorkspaceSize
+*   Description: Size of the dictionary LZWDecodeWs needs.
+*   Returned   : Bytes of workspace.
+***************************************************************************/
+long LZWDecodeWorkspaceSize(void)
+{
+    return MAX_DECODES * sizeof(decode_dictionary_t);
+}
+
+/***************************************************************************
+*   Function   : LZWDecode
+*   Description: LZWDecodeWs with the dictionary allocated for the call.
+***************************************************************************/
+long LZWDecode(const uint8_t* fpIn, long length, char *fpOut, long capacity)
+{
+    void *dictionary;
+    long outLen;
+
+    dictionary = MemAlloc(LZWDecodeWorkspaceSize());
+
+    if (NULL == dictionary)
+    {
+        perror("Making Dictionary");
+        return -1;
+    }
+
+    outLen = LZWDecodeWs(fpIn, length, fpOut, capacity, dictionary,
+        LZWDecodeWorkspaceSize());
+    MemFree(dictionary);
+
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeWs
 *   Description: This routine reads an input file 1 encoded string at a
 *                time and decodes it using the LZW algorithm.
-*   Parameters : fpIn - pointer to the open binary file to decode
-*                fpOut - pointer to the open binary file to write decoded
-*                       output
-*   Effects    : fpIn is decoded using the LZW algorithm with CODE_LEN codes
-*                and written to fpOut.  Neither file is closed after exit.
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
-***************************************************************************/
-int LZWDecode(int8_t* fpIn, char *fpOut)
+*   Parameters : fpIn - pointer to the bit packed code stream
+*                length - number of bytes in fpIn
+*                fpOut - pointer to the buffer to write decoded output
+*                capacity - size of the fpOut buffer in bytes
+*                workspace - LZWDecodeWorkspaceSize() bytes for the
+*                            dictionary, aligned as by malloc
+*                workspaceSize - size of workspace in bytes
+*   Effects    : fpIn is decoded using the LZW algorithm, reading code
+*                words that grow from MIN_DECODE_LEN to MAX_DECODE_LEN
+*                bits in step with the dictionary, up to END_CODE.
+*                CLEAR_CODE resets the dictionary.  The output is '\0'
+*                terminated when there is room.  The dictionary is in
+*                the caller's workspace, so nothing is allocated and
+*                calls on different threads do not share any state.
+*   Returned   : Number of chars decoded for success, -1 for failure.
+*                errno will be set in the event of a failure.
+***************************************************************************/
+long LZWDecodeWs(const uint8_t* fpIn, long length, char *fpOut,
+    long capacity, void *workspace, long workspaceSize)
 {
 
 	unsigned int nextCode;              /* value of next code */
 	unsigned int lastCode;              /* last decoded code word */
 	unsigned int code;                  /* code word to decode */
     unsigned char currentCodeLen;       /* length of code words now */
-    unsigned char c;                    /* last decoded character */
+    long outLen;                        /* chars written to fpOut */
+    BIT_STREAM bfpIn;                   /* bit packed input */
+
+    /* dictionary of string the code word is the dictionary index.  The
+     * symbols are entries too, so every code is looked up the same way. */
+    decode_dictionary_t *dictionary;
 
     /* validate arguments */
-    if ((NULL == fpIn) || (NULL == fpOut))
+    if ((NULL == fpIn) || (NULL == fpOut) || (NULL == workspace))
     {
         errno = ENOENT;
         return -1;
     }
 
-    /* start MIN_CODE_LEN bit code words */
+    if (workspaceSize < LZWDecodeWorkspaceSize())
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    dictionary = workspace;
+
+    /* the symbols are the strings of length 1 */
+    for (code = 0; code < LZW_SYMBOLS; code++)
+    {
+        dictionary[code].prefixCode = 0;
+        dictionary[code].length = 1;
+        dictionary[code].suffixChar = code;
+        dictionary[code].firstChar = code;
+    }
+
+    initialize_input_bitstream(&bfpIn, fpIn, length);
+
+    /* start MIN_DECODE_LEN bit code words */
     currentCodeLen = MIN_DECODE_LEN;
 
     /* initialize for decoding */
     nextCode = FIRST_CODE;  /* code for next (first) string */
+    lastCode = END_CODE;    /* no string decoded since the last clear */
+    outLen = 0;
 
-    /* first code from file must be a character.  use it for initial values */
-    lastCode = *fpIn++ + '0';
-    c = lastCode;
-    //fputc(lastCode, fpOut);
-    if (checkErrors(lastCode,*fpOut++) == -1) return -1;
     /* decode rest of file */
-    while (*fpIn != -1)
+    for (;;)
     {
-    	code = *fpIn++;
-    	if (code < 10)
-    		code += '0';
-    	else if (code == 10)
-    		code = '.';
-    	else code += FIRST_CODE - INIT_CODE;
-
-        /* look for code length increase marker */
-        while (((CURRENT_MAX_DECODES(currentCodeLen) - 1) == code) &&
+        /* the code words grow as soon as the next entry needs it */
+        while ((nextCode >= CURRENT_MAX_DECODES(currentCodeLen)) &&
             (currentCodeLen < MAX_DECODE_LEN))
         {
             currentCodeLen++;
-            code = *fpIn++;
         }
 
-        if ((code < nextCode) && (code > 57))
+        code = get_bits(&bfpIn, currentCodeLen);
+
+        if (END_CODE == code)
         {
-            /* we have a known code.  decode it */
-            c = DecodeRecursive(code, &fpOut);
-            if (stop) return -1;
+            break;
         }
-        else if (code <= 57 && code >= 46){
-        	c = code;
-        	if (checkErrors(c,*fpOut++) == -1) return -1;
-        }
-        else
+
+        if (CLEAR_CODE == code)
         {
-            /***************************************************************
-            * We got a code that's not in our dictionary.  This must be due
-            * to the string + char + string + char + string exception.
-            * Build the decoded string using the last character + the
-            * string from the last code.
-            ***************************************************************/
-            unsigned char tmp;
+            /* the encoder's dictionary filled up, start over */
+            currentCodeLen = MIN_DECODE_LEN;
+            nextCode = FIRST_CODE;
+            lastCode = END_CODE;
+            continue;
+        }
 
-            tmp = c;
-            c = DecodeRecursive(lastCode, &fpOut);
-            if (stop) return -1;
-            //fputc(tmp, fpOut);
-            if (checkErrors(tmp,*fpOut++) == -1) return -1;
+        if (bfpIn.error ||
+            ((code >= LZW_SYMBOLS) && (code < FIRST_CODE)) ||
+            (code > nextCode) ||
+            ((END_CODE == lastCode) && (code >= LZW_SYMBOLS)))
+        {
+            /* not a code the encoder could have written.  The first
+             * code after a clear must be a character. */
+            errno = EILSEQ;
+            return -1;
         }
 
-        /* if room, add new code to the dictionary */
-        if (nextCode < MAX_DECODES)
+        /* if room, add new code to the dictionary.  It is the last
+         * string plus the first char of this one.  When this code is
+         * the one being added (the string + char + string + char +
+         * string exception) that char is the first char of the last
+         * string, so the entry is complete before it is used. */
+        if ((END_CODE != lastCode) && (nextCode < MAX_DECODES))
         {
-            dictionary[nextCode - FIRST_CODE].prefixCode = lastCode;
-            dictionary[nextCode - FIRST_CODE].suffixChar = c;
+            dictionary[nextCode].prefixCode = lastCode;
+            dictionary[nextCode].length = dictionary[lastCode].length + 1;
+            dictionary[nextCode].firstChar = dictionary[lastCode].firstChar;
+            dictionary[nextCode].suffixChar = (code == nextCode) ?
+                dictionary[lastCode].firstChar : dictionary[code].firstChar;
             nextCode++;
         }
 
-        /* save character and code for use in unknown code word case */
+        if (dictionary[code].length > capacity - outLen)
+        {
+            errno = ENOSPC;
+            return -1;
+        }
+
+        outLen += WriteString(dictionary, code, fpOut + outLen);
+
+        /* save code for use in the unknown code word case */
         lastCode = code;
     }
 
-    if (DEBUG) putc('\n', stdout);
-    /* we've decoded everything, free bitfile structure */
-    //BitFileToFILE(bfpIn);
+    if (outLen < capacity)
+    {
+        fpOut[outLen] = '\0';
+    }
+
+    return outLen;
+}
 
-    return 0;
+/***************************************************************************
+*   Function   : LZWDecodeBytesWorkspaceSize
+*   Description: Size of the dictionary LZWDecodeBytesWs needs.
+*   Returned   : Bytes of workspace.
+***************************************************************************/
+long LZWDecodeBytesWorkspaceSize(void)
+{
+    return MAX_DECODES * sizeof(decode_dictionary_t);
 }
 
 /***************************************************************************
-*   Function   : DecodeRecursive
-*   Description: This function uses the dictionary to decode a code word
-*                into the string it represents and write it to the output
-*                file.  The string is actually built in reverse order and
-*                recursion is used to write it out in the correct order.
-*   Parameters : code - the code word to decode
-*                fpOut - the file that the decoded code word is written to
-*   Effects    : Decoded code word is written to a file
-*   Returned   : The first character in the decoded string
-***************************************************************************/
-static unsigned char DecodeRecursive(int code, char **fpOut)
+*   Function   : LZWDecodeBytes
+*   Description: LZWDecodeBytesWs with the dictionary allocated for the
+*                call.
+***************************************************************************/
+long LZWDecodeBytes(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity)
 {
-    unsigned char c;
-    unsigned char firstChar;
+    void *dictionary;
+    long outLen;
+
+    dictionary = MemAlloc(LZWDecodeBytesWorkspaceSize());
 
-    if (code > 57)
+    if (NULL == dictionary)
     {
-        /* code word is string + c */
-        c = dictionary[code - FIRST_CODE].suffixChar;
-        code = dictionary[code - FIRST_CODE].prefixCode;
+        perror("Making Dictionary");
+        return -1;
+    }
+
+    outLen = LZWDecodeBytesWs(fpIn, length, fpOut, capacity, dictionary,
+        LZWDecodeBytesWorkspaceSize());
+    MemFree(dictionary);
+
+    return outLen;
+}
 
-        /* evaluate new code word for remaining string */
+/***************************************************************************
+*   Function   : LZWDecodeBytesWs
+*   Description: This routine decodes a code stream written by
+*                LZWEncodeBytesWs.
+*   Parameters : fpIn - pointer to the bit packed code stream
+*                length - number of bytes in fpIn
+*                fpOut - pointer to the buffer to write decoded bytes
+*                capacity - size of the fpOut buffer in bytes
+*                workspace - LZWDecodeBytesWorkspaceSize() bytes for the
+*                            dictionary, aligned as by malloc
+*                workspaceSize - size of workspace in bytes
+*   Effects    : As LZWDecodeWs, except that LZW_BYTE_ESCAPE and the 8 bits
+*                after it give a byte the next free code, and the output
+*                is not '\0' terminated.  The escape is read after the
+*                code for the string before the byte, so the entry for
+*                that string plus the byte is made first, just as the
+*                encoder did.
+*   Returned   : Number of bytes decoded for success, -1 for failure.
+*                errno will be set in the event of a failure.
+***************************************************************************/
+long LZWDecodeBytesWs(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity, void *workspace, long workspaceSize)
+{
+    unsigned int nextCode;              /* value of next code */
+    unsigned int lastCode;              /* last decoded code word */
+    unsigned int code;                  /* code word to decode */
+    unsigned int c;                     /* byte after an escape */
+    unsigned int codes;                 /* codes the encoder has made */
+    unsigned char currentCodeLen;       /* length of code words now */
+    long outLen;                        /* bytes written to fpOut */
+    BIT_STREAM bfpIn;                   /* bit packed input */
+    decode_dictionary_t *dictionary;
 
-        firstChar = DecodeRecursive(code, fpOut);
-        if (stop) return -1;
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == fpOut) || (NULL == workspace))
+    {
+        errno = ENOENT;
+        return -1;
     }
-    else
+
+    if (workspaceSize < LZWDecodeBytesWorkspaceSize())
     {
-        /* code word is just c */
-        c = code;
-        firstChar = code;
+        errno = ENOMEM;
+        return -1;
     }
 
-    //fputc(c, fpOut);
-    if (checkErrors(c,**fpOut) == -1) return -1;
-    *fpOut = (*fpOut) + 1;
-    return firstChar;
+    dictionary = workspace;
+    initialize_input_bitstream(&bfpIn, fpIn, length);
+
+    currentCodeLen = LZW_BYTE_MIN_LEN;
+    nextCode = LZW_BYTE_FIRST;
+    lastCode = LZW_BYTE_END;    /* no string decoded since the last clear */
+    outLen = 0;
+
+    for (;;)
+    {
+        /* the encoder is one entry ahead while the last string waits
+         * for its next char */
+        codes = nextCode;
+
+        if ((LZW_BYTE_END != lastCode) && (nextCode < MAX_DECODES))
+        {
+            codes++;
+        }
+
+        while (((codes - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+            (currentCodeLen < MAX_DECODE_LEN))
+        {
+            currentCodeLen++;
+        }
+
+        code = get_bits(&bfpIn, currentCodeLen);
+
+        if (bfpIn.error)
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (LZW_BYTE_END == code)
+        {
+            break;
+        }
+
+        if (LZW_BYTE_CLEAR == code)
+        {
+            currentCodeLen = LZW_BYTE_MIN_LEN;
+            nextCode = LZW_BYTE_FIRST;
+            lastCode = LZW_BYTE_END;
+            continue;
+        }
+
+        if (LZW_BYTE_ESCAPE == code)
+        {
+            c = get_bits(&bfpIn, 8);
+
+            if (bfpIn.error || (nextCode >= MAX_DECODES) ||
+                ((LZW_BYTE_END != lastCode) && (nextCode + 1 >= MAX_DECODES)))
+            {
+                errno = EILSEQ;
+                return -1;
+            }
+
+            /* the last string plus the new byte, then the byte */
+            if (LZW_BYTE_END != lastCode)
+            {
+                dictionary[nextCode].prefixCode = lastCode;
+                dictionary[nextCode].length = dictionary[lastCode].length + 1;
+                dictionary[nextCode].firstChar =
+                    dictionary[lastCode].firstChar;
+                dictionary[nextCode].suffixChar = c;
+                nextCode++;
+            }
+
+            dictionary[nextCode].prefixCode = 0;
+            dictionary[nextCode].length = 1;
+            dictionary[nextCode].firstChar = c;
+            dictionary[nextCode].suffixChar = c;
+            nextCode++;
+
+            /* the byte's code comes next and starts a new string */
+            lastCode = LZW_BYTE_END;
+            continue;
+        }
+
+        if ((code > nextCode) ||
+            ((LZW_BYTE_END == lastCode) && (code >= nextCode)))
+        {
+            /* not a code the encoder could have written */
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if ((LZW_BYTE_END != lastCode) && (nextCode < MAX_DECODES))
+        {
+            dictionary[nextCode].prefixCode = lastCode;
+            dictionary[nextCode].length = dictionary[lastCode].length + 1;
+            dictionary[nextCode].firstChar = dictionary[lastCode].firstChar;
+            dictionary[nextCode].suffixChar = (code == nextCode) ?
+                dictionary[lastCode].firstChar : dictionary[code].firstChar;
+            nextCode++;
+        }
+        else if (code == nextCode)
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (dictionary[code].length > capacity - outLen)
+        {
+            errno = ENOSPC;
+            return -1;
+        }
+
+        outLen += WriteBytes(dictionary, code, fpOut + outLen);
+        lastCode = code;
+    }
+
+    return outLen;
 }
 
-int checkErrors(char in, char out){
-	if (in != out){
-		printf("-> DATA CORRUPTED\n Expected [%c] but decoded [%c]\n", out, in);
-		stop = 1;
-		return -1;
-	}
-    if (DEBUG) putc((char)in, stdout);
-	return 0;
+/***************************************************************************
+*   Function   : WriteString
+*   Description: This function uses the dictionary to decode a code word
+*                into the string it represents.  The entry's length gives
+*                the position of the last char, so the string is written
+*                back to front straight into the output in a single loop.
+*   Parameters : dictionary - the decoder's dictionary
+*                code - the code word to decode
+*                fpOut - where the decoded string goes
+*   Effects    : Decoded string is written to fpOut
+*   Returned   : The length of the decoded string
+***************************************************************************/
+static int WriteString(const decode_dictionary_t *dictionary,
+    unsigned int code, char *fpOut)
+{
+    int stringLen;
+    int i;
+
+    stringLen = dictionary[code].length;
+
+    for (i = stringLen - 1; i >= 0; i--)
+    {
+        fpOut[i] = SchemaChar(dictionary[code].suffixChar);
+        code = dictionary[code].prefixCode;
+    }
+
+    return stringLen;
+}
+
+/***************************************************************************
+*   Function   : WriteBytes
+*   Description: WriteString for the byte mode, where the dictionary holds
+*                the bytes themselves rather than symbols.
+*   Parameters : dictionary - the decoder's dictionary
+*                code - the code word to decode
+*                fpOut - where the decoded string goes
+*   Effects    : Decoded string is written to fpOut
+*   Returned   : The length of the decoded string
+***************************************************************************/
+static int WriteBytes(const decode_dictionary_t *dictionary,
+    unsigned int code, uint8_t *fpOut)
+{
+    int stringLen;
+    int i;
+
+    stringLen = dictionary[code].length;
+
+    for (i = stringLen - 1; i >= 0; i--)
+    {
+        fpOut[i] = dictionary[code].suffixChar;
+        code = dictionary[code].prefixCode;
+    }
+
+    return stringLen;
 }
@@ -35,27 +35,34 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <errno.h>
 #include "lzw.h"
+#include "bitio.h"
+#include "memtrack.h"
+#include "profile.h"
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
-/* node in dictionary tree */
-typedef struct dict_node_t
+/* slot in the dictionary hash table */
+typedef struct
 {
-	uint64_t codeWord;      /* code word for this entry */
+    uint16_t codeWord;          /* code word for this entry, 0 if free */
+    uint16_t prefixCode;        /* code for remaining chars in string */
     unsigned char suffixChar;   /* last char in encoded string */
-    uint64_t prefixCode;    /* code for remaining chars in string */
-
-    /* pointer to child nodes */
-    struct dict_node_t *left;   /* child with < key */
-    struct dict_node_t *right;  /* child with >= key */
-} dict_node_t;
+} dict_entry_t;
 
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define HASH_BITS       (MAX_DECODE_LEN + 1)    /* log2 of hash table slots */
+#define HASH_SIZE       (1 << HASH_BITS)
+
+#if (HASH_SIZE < 2 * MAX_DECODES)
+#error The hash table must be at least twice the size of the dictionary
+#endif
 
 /***************************************************************************
 *                                  MACROS
@@ -69,18 +76,12 @@ typedef struct dict_node_t
 *                               PROTOTYPES
 ***************************************************************************/
 
-/* dictionary tree node create/free */
-static dict_node_t *MakeNode(const uint64_t codeWord,
-    const uint64_t prefixCode, const unsigned char suffixChar);
-static void FreeTree(dict_node_t *node);
-
-/* searches tree for matching dictionary entry */
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const uint64_t prefixCode, const unsigned char c);
+/* empties the dictionary */
+static void ClearDictionary(dict_entry_t *dict);
 
-/* makes key from prefix code and character */
-static uint64_t MakeKey(const uint64_t prefixCode,
-    const unsigned char suffixChar);
+/* searches hash table for matching dictionary entry */
+static dict_entry_t *FindDictionaryEntry(dict_entry_t *dict,
+    const unsigned int prefixCode, const unsigned char c);
 
 /* write encoded data */
 
@@ -89,43 +90,120 @@ static uint64_t MakeKey(const uint64_t prefixCode,
 ***************************************************************************/
 
 /***************************************************************************
-*   Function   : LZWEncodeFile
+*   Function   : LZWEncodeWorkspaceSize
+*   Description: Size of the dictionary LZWEncodeWs needs.
+*   Returned   : Bytes of workspace.
+***************************************************************************/
+long LZWEncodeWorkspaceSize(void)
+{
+    return HASH_SIZE * sizeof(dict_entry_t);
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeBound
+*   Description: Worst case size of the code stream.  Every code word
+*                stands for at least one char and is at most
+*                MAX_DECODE_LEN bits, a clear is sent at most once per
+*                dictionary's worth of codes, and END_CODE comes last.
+*   Parameters : length - number of chars to encode
+*   Returned   : Bytes LZWEncode may write.
+***************************************************************************/
+long LZWEncodeBound(long length)
+{
+    long codes;
+
+    codes = length + length / (MAX_DECODES - FIRST_CODE) + 1;
+
+    return (codes * MAX_DECODE_LEN + 7) / 8;
+}
+
+/***************************************************************************
+*   Function   : LZWEncode
+*   Description: LZWEncodeWs with the dictionary allocated for the call.
+***************************************************************************/
+long LZWEncode(char* fpIn, uint8_t* fpOut, long capacity)
+{
+    void *dict;
+    long length;
+
+    dict = MemAlloc(LZWEncodeWorkspaceSize());
+
+    if (NULL == dict)
+    {
+        perror("Making Dictionary");
+        return -1;
+    }
+
+    length = LZWEncodeWs(fpIn, fpOut, capacity, dict,
+        LZWEncodeWorkspaceSize());
+    MemFree(dict);
+
+    return length;
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeWs
 *   Description: This routine reads an input file 1 character at a time and
 *                writes out an LZW encoded version of that file.
 *   Parameters : fpIn - pointer to the open binary file to encode
-*                fpOut - pointer to the open binary file to write encoded
-*                       output
-*   Effects    : fpIn is encoded using the LZW algorithm with CODE_LEN codes
-*                and written to fpOut.  Neither file is closed after exit.
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
+*                fpOut - pointer to the buffer to write encoded output
+*                capacity - size of the fpOut buffer in bytes,
+*                           LZWEncodeBound() is always enough
+*                workspace - LZWEncodeWorkspaceSize() bytes for the
+*                            dictionary, aligned as by malloc
+*                workspaceSize - size of workspace in bytes
+*   Effects    : fpIn is encoded using the LZW algorithm and written to
+*                fpOut as a bit packed stream of code words.  Code words
+*                start MIN_DECODE_LEN bits long and grow by one bit each
+*                time the dictionary outgrows them, up to MAX_DECODE_LEN
+*                bits.  The stream is terminated by END_CODE.  When the
+*                dictionary is full it is cleared and CLEAR_CODE is sent,
+*                either right away or, with LZW_MONITOR_RATIO, once the
+*                compression ratio stops improving.
+*                The dictionary is an open addressing hash table in the
+*                caller's workspace, so nothing is allocated.
+*   Returned   : Number of bytes written for success, -1 for failure.
+*                errno will be set in the event of a failure.
 ***************************************************************************/
-int LZWEncode(char* fpIn, int8_t* fpOut)
+long LZWEncodeWs(const char* fpIn, uint8_t* fpOut, long capacity,
+    void *workspace, long workspaceSize)
 {
-	uint64_t code;                  /* code for current string */
+    unsigned int code;                  /* code for current string */
     unsigned char currentCodeLen;       /* length of the current code */
-    uint64_t nextCode;              /* next available code index */
-    uint64_t c;                              /* character to add to string */
-
-    dict_node_t *dictRoot;              /* root of dictionary tree */
-    dict_node_t *node;                  /* node of dictionary tree */
+    unsigned int nextCode;              /* next available code index */
+    unsigned int c;                     /* character to add to string */
+
+    dict_entry_t *dict;                 /* dictionary hash table */
+    dict_entry_t *entry;                /* entry of dictionary */
+    BIT_STREAM bfpOut;                  /* bit packed output */
+    long length;
+    unsigned long inCount;              /* chars read since last clear */
+    unsigned long outBits;              /* bits written since last clear */
+    unsigned long checkPoint;           /* inCount of next ratio check */
+    unsigned long ratio;                /* in/out ratio, 8 bit fraction */
+    unsigned long bestRatio;            /* best ratio since last clear */
+#if CODEC_PROFILE
+    unsigned long depth = 1;            /* chars matched by code */
+#endif
 
 
     /* validate arguments */
-    if ((NULL == fpIn) || (NULL == fpOut))
+    if ((NULL == fpIn) || (NULL == fpOut) || (NULL == workspace))
     {
         errno = ENOENT;
         return -1;
     }
 
+    if (workspaceSize < LZWEncodeWorkspaceSize())
+    {
+        errno = ENOMEM;
+        return -1;
+    }
 
-    /* initialize dictionary as empty */
-    dictRoot = NULL;
-
-    /* start MIN_CODE_LEN bit code words */
-    currentCodeLen = MIN_CODE_LEN;
+    /* start MIN_DECODE_LEN bit code words */
+    currentCodeLen = MIN_DECODE_LEN;
 
-    nextCode = INIT_CODE;  /* code for next (first) string */
+    nextCode = FIRST_CODE;  /* code for next (first) string */
 
     /* now start the actual encoding process */
 
@@ -135,271 +213,438 @@ int LZWEncode(char* fpIn, int8_t* fpOut)
     {
         return -1;      /* empty file */
     }
-    else
+
+    /* start with first character */
+    if (SchemaSymbol(c) < 0)
     {
-        code = c - '0';       /* start with code string = first character */
+        errno = EILSEQ;
+        return -1;
     }
 
-    /* create a tree root from 1st 2 character string */
-    if ((c = *fpIn++) != '\0')
-    {
-    	if (c != '.') c = c - '0';
-    	else c = 10;
-        /* special case for NULL root */
-        dictRoot = MakeNode(nextCode, code, c);
+    code = SchemaSymbol(c);
 
-        if (NULL == dictRoot)
-        {
-            perror("Making Dictionary Root");
-            //BitFileToFILE(bfpOut);
-            return -1;
-        }
+    /* initialize dictionary as empty */
+    dict = workspace;
+    ClearDictionary(dict);
 
-        nextCode++;
-
-        /* write code for 1st char */
-        *fpOut++ = code;
-        /* new code is just 2nd char */
-        code = c;
-    }
+    initialize_output_bitstream(&bfpOut, fpOut, capacity);
+    inCount = 1;
+    outBits = 0;
+    checkPoint = LZW_CHECK_GAP;
+    bestRatio = 0;
 
     /* now encode normally */
     while ((c = *fpIn++) != '\0')
     {
-    	if (c != '.') c = c - '0';
-    	else c = 10;
+        if (SchemaSymbol(c) < 0)
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        c = SchemaSymbol(c);
+
+        inCount++;
         /* look for code + c in the dictionary */
-        node = FindDictionaryEntry(dictRoot, code, c);
+        entry = FindDictionaryEntry(dict, code, c);
 
-        if ((node->prefixCode == code) &&
-            (node->suffixChar == c))
+        if (entry->codeWord != 0)
         {
             /* code + c is in the dictionary, make it's code the new code */
-            code = node->codeWord;
+            code = entry->codeWord;
+#if CODEC_PROFILE
+            depth++;
+#endif
+            continue;
         }
-        else
-        {
-            /* code + c is not in the dictionary, add it if there's room */
-            if (nextCode <= MAX_CODE_LEN)
-            {
-                dict_node_t *tmp;
-
 
-                tmp = MakeNode(nextCode, code, c);
+        /* are we using enough bits to write out this code word? */
+        while (((nextCode - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+            (currentCodeLen < MAX_DECODE_LEN))
+        {
+            currentCodeLen++;
+        }
 
-                if (NULL == dictRoot)
-                {
-                    perror("Making Dictionary Node");
-                    FreeTree(dictRoot);
-                    //BitFileToFILE(bfpOut);
-                    return -1;
-                }
+        /* write out code for the string before c was added */
+        put_bits(&bfpOut, currentCodeLen, code);
+        outBits += currentCodeLen;
+        PROFILE_COUNT(PROFILE_CODES, 1);
+        PROFILE_COUNT(PROFILE_DEPTH, depth);
+        PROFILE_MAX(PROFILE_MAX_DEPTH, depth);
+#if CODEC_PROFILE
+        depth = 1;
+#endif
+
+        /* code + c is not in the dictionary, add it if there's room */
+        if (nextCode < MAX_DECODES)
+        {
+            entry->codeWord = nextCode;
+            entry->prefixCode = code;
+            entry->suffixChar = c;
+            nextCode++;
+        }
+        else if (!LZW_MONITOR_RATIO || (inCount >= checkPoint))
+        {
+            /* the dictionary is full, see if it is still paying off */
+            checkPoint = inCount + LZW_CHECK_GAP;
+            ratio = (inCount << 8) / outBits;
 
-                if(nextCode != 9) nextCode++;
-                else nextCode+=2;
-                if (MakeKey(code, c) <
-                    MakeKey(node->prefixCode, node->suffixChar))
-                {
-                    node->left = tmp;
-                }
-                else
-                {
-                    node->right = tmp;
-                }
+            if (LZW_MONITOR_RATIO && (ratio > bestRatio))
+            {
+                bestRatio = ratio;
             }
             else
             {
-            	printf("%lli/%i\n",nextCode, MAX_CODE_LEN);
-                fprintf(stderr, "Error: Dictionary Full\n");
-                free(dictRoot);
-                return -1;
+                /* the decoder reads this code before it knows the
+                 * dictionary is full, so it is MAX_DECODE_LEN bits */
+                put_bits(&bfpOut, currentCodeLen, CLEAR_CODE);
+                ClearDictionary(dict);
+                nextCode = FIRST_CODE;
+                currentCodeLen = MIN_DECODE_LEN;
+                inCount = 1;
+                outBits = 0;
+                checkPoint = LZW_CHECK_GAP;
+                bestRatio = 0;
             }
-
-            /* are we using enough bits to write out this code word? */
-//            while ((code >= (CURRENT_MAX_CODES(currentCodeLen) - 1)) &&
-//                (currentCodeLen < MAX_CODE_LEN))
-//            {
-//                /* mark need for bigger code word with all ones */
-////                PutCodeWord(bfpOut, (CURRENT_MAX_CODES(currentCodeLen) - 1),
-////                    currentCodeLen);
-//
-//                currentCodeLen++;
-//            }
-
-            /* write out code for the string before c was added */
-            *fpOut++ = code;
-            /* new code is just c */
-            code = c;
         }
+
+        /* new code is just c */
+        code = c;
     }
 
     /* no more input.  write out last of the code. */
-    *fpOut++ = code;
-    *fpOut = -1;
-    /* we've encoded everything, free bitfile structure */
-    //BitFileToFILE(bfpOut);
+    while (((nextCode - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+        (currentCodeLen < MAX_DECODE_LEN))
+    {
+        currentCodeLen++;
+    }
+    put_bits(&bfpOut, currentCodeLen, code);
+    PROFILE_COUNT(PROFILE_CODES, 1);
+    PROFILE_COUNT(PROFILE_DEPTH, depth);
+    PROFILE_MAX(PROFILE_MAX_DEPTH, depth);
+
+    /* the decoder adds an entry for the last code before it reads the
+     * end code, so size the end code as if that entry existed */
+    while ((nextCode >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+        (currentCodeLen < MAX_DECODE_LEN))
+    {
+        currentCodeLen++;
+    }
+    put_bits(&bfpOut, currentCodeLen, END_CODE);
+    length = flush_output_bitstream(&bfpOut);
 
-    /* free the dictionary */
-    FreeTree(dictRoot);
+    if (length < 0)
+    {
+        errno = ENOSPC;
+    }
 
-    return 0;
+    return length;
 }
 
 /***************************************************************************
-*   Function   : MakeKey
-*   Description: This routine creates a simple key from a prefix code and
-*                an appended character.  The key may be used to establish
-*                an order when building/searching a dictionary tree.
-*   Parameters : prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
-*   Effects    : None
-*   Returned   : Key built from string represented as a prefix + char.  Key
-*                format is {ms nibble of c} + prefix + {ls nibble of c}
+*   Function   : LZWEncodeBytesWorkspaceSize
+*   Description: Size of the dictionary and the table of byte codes
+*                LZWEncodeBytesWs needs.
+*   Returned   : Bytes of workspace.
 ***************************************************************************/
-static uint64_t MakeKey(const uint64_t prefixCode,
-    const unsigned char suffixChar)
+long LZWEncodeBytesWorkspaceSize(void)
 {
-	uint64_t key;
-
-    /* position ms nibble */
-    key = suffixChar & 0xF0;
-    key <<= MAX_CODE_LEN;
+    return HASH_SIZE * sizeof(dict_entry_t) + 256 * sizeof(uint16_t);
+}
 
-    /* include prefix code */
-    key |= (prefixCode << 4);
+/***************************************************************************
+*   Function   : LZWEncodeBytesBound
+*   Description: Worst case size of a byte mode code stream.  Every byte
+*                may be new, costing an escape and 8 bits on top of its
+*                own code.  A byte adds at most two entries, so a clear
+*                is sent at most once per half a dictionary of bytes.
+*   Parameters : length - number of bytes to encode
+*   Returned   : Bytes LZWEncodeBytes may write.
+***************************************************************************/
+long LZWEncodeBytesBound(long length)
+{
+    long codes;
 
-    /* inclulde ls nibble */
-    key |= (suffixChar & 0x0F);
+    codes = 2 * length + (2 * length) / (MAX_DECODES - LZW_BYTE_FIRST) + 2;
 
-    return key;
+    return (codes * MAX_DECODE_LEN + 8 * length + 7) / 8;
 }
 
 /***************************************************************************
-*   Function   : MakeNode
-*   Description: This routine creates and initializes a dictionary entry
-*                for a string and the code word that encodes it.
-*   Parameters : codeWord - code word used to encode the string prefixCode +
-*                           suffixChar
-*                prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
-*   Effects    : Node is allocated for new dictionary entry
-*   Returned   : Pointer to newly allocated node or NULL on error.
-*                errno will be set on an error.
+*   Function   : LZWEncodeBytes
+*   Description: LZWEncodeBytesWs with the workspace allocated for the
+*                call.
 ***************************************************************************/
-static dict_node_t *MakeNode(const uint64_t codeWord,
-    const uint64_t prefixCode, const unsigned char suffixChar)
+long LZWEncodeBytes(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity)
 {
-    dict_node_t *node;
+    void *dict;
+    long outLen;
 
-    node = malloc(sizeof(dict_node_t));
+    dict = MemAlloc(LZWEncodeBytesWorkspaceSize());
 
-    if (NULL != node)
+    if (NULL == dict)
     {
-        node->codeWord = codeWord;
-        node->prefixCode = prefixCode;
-        node->suffixChar = suffixChar;
-
-        node->left = NULL;
-        node->right = NULL;
+        perror("Making Dictionary");
+        return -1;
     }
 
-    return node;
+    outLen = LZWEncodeBytesWs(fpIn, length, fpOut, capacity, dict,
+        LZWEncodeBytesWorkspaceSize());
+    MemFree(dict);
+
+    return outLen;
 }
 
 /***************************************************************************
-*   Function   : FreeTree
-*   Description: This routine will free all nodes of a tree rooted at the
-*                node past as a parameter.
-*   Parameters : node - root of tree to free
-*   Effects    : frees allocated tree node from initial parameter down.
-*   Returned   : none
+*   Function   : LZWEncodeBytesWs
+*   Description: This routine LZW encodes a buffer of bytes of any value.
+*   Parameters : fpIn - pointer to the bytes to encode
+*                length - number of bytes in fpIn
+*                fpOut - pointer to the buffer to write encoded output
+*                capacity - size of the fpOut buffer in bytes,
+*                           LZWEncodeBytesBound() is always enough
+*                workspace - LZWEncodeBytesWorkspaceSize() bytes, aligned
+*                            as by malloc
+*                workspaceSize - size of workspace in bytes
+*   Effects    : As LZWEncodeWs, except that the dictionary starts out
+*                with no single byte strings.  The first time a byte is
+*                seen LZW_BYTE_ESCAPE and the byte's 8 bits are written,
+*                and the byte is given the next free code.  That code is
+*                then used like any other, so a byte costs its 8 bits once
+*                per dictionary and the code words only grow as wide as
+*                the bytes actually used need.  A byte that comes up when
+*                the dictionary is full clears it.
+*   Returned   : Number of bytes written for success, -1 for failure.
+*                errno will be set in the event of a failure.
 ***************************************************************************/
-static void FreeTree(dict_node_t *node)
+long LZWEncodeBytesWs(const uint8_t* fpIn, long length, uint8_t* fpOut,
+    long capacity, void *workspace, long workspaceSize)
 {
-    if (NULL == node)
+    unsigned int code;                  /* code for current string */
+    unsigned char currentCodeLen;       /* length of the current code */
+    unsigned int nextCode;              /* next available code index */
+    unsigned int c;                     /* byte to add to string */
+
+    dict_entry_t *dict;                 /* dictionary hash table */
+    dict_entry_t *entry;                /* entry of dictionary */
+    uint16_t *byteCode;                 /* code of each byte, 0 if unseen */
+    BIT_STREAM bfpOut;                  /* bit packed output */
+    long i;
+    long outLen;
+    unsigned long inCount;              /* bytes read since last clear */
+    unsigned long outBits;              /* bits written since last clear */
+    unsigned long checkPoint;           /* inCount of next ratio check */
+    unsigned long ratio;                /* in/out ratio, 8 bit fraction */
+    unsigned long bestRatio;            /* best ratio since last clear */
+    int clear;
+
+    /* validate arguments */
+    if (((NULL == fpIn) && (length > 0)) || (NULL == fpOut) ||
+        (NULL == workspace) || (length < 0))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (workspaceSize < LZWEncodeBytesWorkspaceSize())
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    dict = workspace;
+    byteCode = (uint16_t *)(dict + HASH_SIZE);
+    ClearDictionary(dict);
+    memset(byteCode, 0, 256 * sizeof(uint16_t));
+
+    initialize_output_bitstream(&bfpOut, fpOut, capacity);
+    currentCodeLen = LZW_BYTE_MIN_LEN;
+    nextCode = LZW_BYTE_FIRST;
+    code = LZW_BYTE_END;    /* no string yet */
+    inCount = 0;
+    outBits = 0;
+    checkPoint = LZW_CHECK_GAP;
+    bestRatio = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        c = fpIn[i];
+        inCount++;
+        clear = 0;
+
+        if (LZW_BYTE_END != code)
+        {
+            /* look for code + c in the dictionary */
+            entry = FindDictionaryEntry(dict, code, c);
+
+            if (entry->codeWord != 0)
+            {
+                code = entry->codeWord;
+                continue;
+            }
+
+            while (((nextCode - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+                (currentCodeLen < MAX_DECODE_LEN))
+            {
+                currentCodeLen++;
+            }
+
+            put_bits(&bfpOut, currentCodeLen, code);
+            outBits += currentCodeLen;
+            PROFILE_COUNT(PROFILE_CODES, 1);
+
+            if (nextCode < MAX_DECODES)
+            {
+                entry->codeWord = nextCode;
+                entry->prefixCode = code;
+                entry->suffixChar = c;
+                nextCode++;
+            }
+            else if (!LZW_MONITOR_RATIO || (inCount >= checkPoint))
+            {
+                /* the dictionary is full, see if it is still paying off */
+                checkPoint = inCount + LZW_CHECK_GAP;
+                ratio = (inCount << 8) / outBits;
+
+                if (LZW_MONITOR_RATIO && (ratio > bestRatio))
+                {
+                    bestRatio = ratio;
+                }
+                else
+                {
+                    clear = 1;
+                }
+            }
+
+            code = LZW_BYTE_END;
+        }
+
+        /* a new byte needs a code of its own, clear if there is none */
+        if ((0 == byteCode[c]) && (nextCode >= MAX_DECODES))
+        {
+            clear = 1;
+        }
+
+        if (clear)
+        {
+            /* the decoder reads this code before it knows the
+             * dictionary is full, so it is MAX_DECODE_LEN bits */
+            put_bits(&bfpOut, currentCodeLen, LZW_BYTE_CLEAR);
+            ClearDictionary(dict);
+            memset(byteCode, 0, 256 * sizeof(uint16_t));
+            nextCode = LZW_BYTE_FIRST;
+            currentCodeLen = LZW_BYTE_MIN_LEN;
+            inCount = 1;
+            outBits = 0;
+            checkPoint = LZW_CHECK_GAP;
+            bestRatio = 0;
+        }
+
+        if (0 == byteCode[c])
+        {
+            /* the decoder has made the entry for the last code by the
+             * time it reads the escape, so nextCode is up to date */
+            while (((nextCode - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+                (currentCodeLen < MAX_DECODE_LEN))
+            {
+                currentCodeLen++;
+            }
+
+            put_bits(&bfpOut, currentCodeLen, LZW_BYTE_ESCAPE);
+            put_bits(&bfpOut, 8, c);
+            outBits += currentCodeLen + 8;
+            byteCode[c] = nextCode;
+            nextCode++;
+        }
+
+        /* new string is just c */
+        code = byteCode[c];
+    }
+
+    /* no more input.  write out last of the code. */
+    while (((nextCode - 1) >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+        (currentCodeLen < MAX_DECODE_LEN))
     {
-        /* nothing to free */
-        return;
+        currentCodeLen++;
     }
 
-    /* free left branch */
-    if (node->left != NULL)
+    if (LZW_BYTE_END != code)
     {
-        FreeTree(node->left);
+        put_bits(&bfpOut, currentCodeLen, code);
+        PROFILE_COUNT(PROFILE_CODES, 1);
+
+        /* the decoder adds an entry for the last code before it reads
+         * the end code */
+        while ((nextCode >= CURRENT_MAX_DECODES(currentCodeLen)) &&
+            (currentCodeLen < MAX_DECODE_LEN))
+        {
+            currentCodeLen++;
+        }
     }
 
-    /* free right branch */
-    if (node->right != NULL)
+    put_bits(&bfpOut, currentCodeLen, LZW_BYTE_END);
+    outLen = flush_output_bitstream(&bfpOut);
+
+    if (outLen < 0)
     {
-        FreeTree(node->right);
+        errno = ENOSPC;
     }
 
-    /* free root */
-    free(node);
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : ClearDictionary
+*   Description: This routine marks every slot of the dictionary hash
+*                table as free.
+*   Parameters : dict - the dictionary hash table
+*   Effects    : The dictionary is emptied
+*   Returned   : None
+***************************************************************************/
+static void ClearDictionary(dict_entry_t *dict)
+{
+    memset(dict, 0, HASH_SIZE * sizeof(dict_entry_t));
 }
 
 /***************************************************************************
 *   Function   : FindDictionaryEntry
-*   Description: This routine searches the dictionary tree for an entry
-*                with a matching string (prefix code + suffix character).
-*                If one isn't found, the parent node for that string is
-*                returned.
-*   Parameters : prefixCode - code for the prefix of string
+*   Description: This routine searches the dictionary hash table for an
+*                entry with a matching string (prefix code + suffix
+*                character).  Collisions are resolved by linear probing.
+*   Parameters : dict - the dictionary hash table
+*                prefixCode - code for the prefix of string
 *                c - last character in string
 *   Effects    : None
-*   Returned   : If string is in dictionary, pointer to node containing
-*                string, otherwise pointer to suitable parent node.  NULL
-*                is returned for an empty tree.
+*   Returned   : If string is in dictionary, pointer to slot containing
+*                string, otherwise pointer to the free slot where it may
+*                be added.
 ***************************************************************************/
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const uint64_t prefixCode, const unsigned char c)
+static dict_entry_t *FindDictionaryEntry(dict_entry_t *dict,
+    const unsigned int prefixCode, const unsigned char c)
 {
-	uint64_t searchKey, key;
+    uint32_t slot;
+    PROFILE_START(start);
 
-    if (NULL == root)
-    {
-        return NULL;
-    }
+    /* multiplicative hash of the (prefix, char) pair */
+    slot = (((uint32_t)prefixCode << 8) | c) * 2654435761UL;
+    slot >>= (32 - HASH_BITS);
 
-    searchKey = MakeKey(prefixCode, c);     /* key of string to find */
+    PROFILE_COUNT(PROFILE_PROBES, 1);
 
-    while (1)
+    while (dict[slot].codeWord != 0)
     {
-        /* key of current node */
-        key = MakeKey(root->prefixCode, root->suffixChar);
-
-        if (key == searchKey)
-        {
-            /* current node contains string */
-            return root;
-        }
-        else if (searchKey < key)
-        {
-            if (NULL != root->left)
-            {
-                /* check left branch for string */
-                root = root->left;
-            }
-            else
-            {
-                /* string isn't in tree, it can be added as a left child */
-                return root;
-            }
-        }
-        else
+        if ((dict[slot].prefixCode == prefixCode) &&
+            (dict[slot].suffixChar == c))
         {
-            if (NULL != root->right)
-            {
-                /* check right branch for string */
-                root = root->right;
-            }
-            else
-            {
-                /* string isn't in tree, it can be added as a right child */
-                return root;
-            }
+            /* slot contains string */
+            break;
         }
+
+        slot = (slot + 1) & (HASH_SIZE - 1);
+        PROFILE_COUNT(PROFILE_PROBES, 1);
     }
+
+    PROFILE_STOP(PROFILE_DICT, start);
+    return &dict[slot];
 }
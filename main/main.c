@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "sdkconfig.h"
@@ -13,28 +14,131 @@
 
 #include "arith_coder.h"
 #include "lzw.h"
+#include "verify.h"
+#include "transform.h"
+#include "delta_codec.h"
+#include "container.h"
+#include "pipeline.h"
+#include "corpus.h"
+#include "bench.h"
+#include "profile.h"
+#include "memtrack.h"
+#include "schema.h"
 
 #ifdef CONFIG_IDF_TARGET_ESP32
 #define CHIP_NAME "ESP32"
 #endif
 
 //Test evaluation variables
-#define INTEGER_DIG 2
-#define DECIMAL_DIG 2
-#define N_SAMPLES 0 //Max: 118(AC) 35(LWZ)
-#define CODING_TYPE 0// 0 -> Arithmetic, 1 -> LZW, 2 -> Both
+#define INTEGER_DIG SCHEMA_INTEGER_DIGITS// Sample layout and alphabet are set in schema.h
+#define DECIMAL_DIG SCHEMA_DECIMAL_DIGITS
+#define N_SAMPLES 0
+#define CODING_TYPE 0// 0 -> Arithmetic, 1 -> LZW, 2 -> Both, 3 -> Delta
+#define VERIFY_OUTPUT 1// 1 -> Compare the decoded output with the input
+#define PRE_TRANSFORM 1// 1 -> Drop the fixed '.' of each sample before coding
+#define CORPUS_KIND CORPUS_UNIFORM// Shape of the generated samples, see corpus.h
+#define CORPUS_SEED 1// Same seed, same input on every run
+#define BENCHMARK_MODE 0// 1 -> Run the codec sweep in bench.c and print CSV
+#define PIPELINE_MODE 0// 1 -> Sample, compress and ship on separate cores
+#define PIPELINE_SAMPLES 100000
+#define PIPELINE_BLOCK 1024
 
 //Global variables
 char digits[] = { '0','1','2','3','4','5','6','7','8','9'};
-extern uint8_t stop;
-int sample_length = (INTEGER_DIG + DECIMAL_DIG + 1);
+uint8_t stop = 0;
+int sample_length = SCHEMA_SAMPLE_LENGTH;
 /*
  * This example program compresses an input string, sending
  * the output to a file.  It then expands the output file,
  * sending the decoded characters to the screen.
  */
 
+/*
+ * Round trip check, kept out of the decoders so it can be switched
+ * off with VERIFY_OUTPUT.  Returns -1 on a mismatch.
+ */
+static int check_output(const char* input, const char* decoded,
+		long decoded_length, int stream_length){
+	long mismatch;
+
+	if (decoded_length != stream_length){
+		printf("-> DATA CORRUPTED\n Expected %i chars but decoded %ld\n",
+				stream_length, decoded_length);
+		return -1;
+	}
+	mismatch = VerifyBuffers(input, decoded, stream_length);
+	if (mismatch >= 0){
+		printf("-> DATA CORRUPTED\n Expected [%c] but decoded [%c]\n",
+				input[mismatch], decoded[mismatch]);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Pipeline source, random samples in the same format as the buffered
+ * mode, PIPELINE_SAMPLES of them in all.
+ */
+static long pipeline_source(void* opaque, char* samples, long max){
+	long* remaining = opaque;
+	long n = 0;
+	int j;
 
+	while (*remaining > 0 && n + sample_length <= max){
+		for (j = 0; j < sample_length; j++){
+			if (j == SCHEMA_SIGNED + INTEGER_DIG) samples[n++] = SCHEMA_SEPARATOR;
+			else if (j < SCHEMA_SIGNED) samples[n++] = (esp_random() & 1) ? '-' : '+';
+			else samples[n++] = digits[esp_random() % (sizeof(digits))];
+		}
+		(*remaining)--;
+	}
+	return n;
+}
+
+/*
+ * Pipeline sink, stands in for the radio by counting what would be sent
+ * and summing it, so runs can be compared block for block.
+ */
+typedef struct {
+	long bytes;
+	uint32_t checksum;		//Adler-32 of everything shipped
+} pipeline_shipped_t;
+
+static int pipeline_sink(void* opaque, const uint8_t* block, long length){
+	pipeline_shipped_t* shipped = opaque;
+	uint32_t a = shipped->checksum & 0xFFFF;
+	uint32_t b = shipped->checksum >> 16;
+	long i;
+
+	for (i = 0; i < length; i++){
+		a = (a + block[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	shipped->checksum = (b << 16) | a;
+	shipped->bytes += length;
+	return 0;
+}
+
+static void run_pipeline(){
+	long remaining = PIPELINE_SAMPLES;
+	pipeline_shipped_t shipped = {0, 1};
+	int64_t start;
+	pipeline_config_t config = {
+		CODING_TYPE == 1 ? CODEC_LZW : (CODING_TYPE == 3 ? CODEC_DELTA : CODEC_ARITH),
+		PRE_TRANSFORM ? CONTAINER_STRIPPED : 0,
+		CONTAINER_FORMAT(INTEGER_DIG, DECIMAL_DIG),
+		PIPELINE_BLOCK, 16384,
+		pipeline_source, &remaining,
+		pipeline_sink, &shipped
+	};
+
+	start = esp_timer_get_time();
+	if (PipelineRun(&config) != 0)
+		printf("-> PIPELINE FAILED\n");
+	printf("-> Pipelined %i samples into %ld bytes (adler32 %08X) in %" PRId64 " us\n",
+			PIPELINE_SAMPLES, shipped.bytes, (unsigned int)shipped.checksum,
+			esp_timer_get_time() - start);
+}
 
 void app_main(){
 	esp_err_t esp_timer_init(); //initialization of the timer -- call this function from stratup
@@ -47,39 +151,65 @@ void app_main(){
 	int64_t time_6 = 0;
 	int64_t time_7 = 0;
 	int64_t time_8 = 0;
+	int64_t time_9 = 0;
+	int64_t time_10 = 0;
+	int64_t time_11 = 0;
+	int64_t time_12 = 0;
 	int64_t comp_time_arith = 0;
 	int64_t decomp_time_arith = 0;
 	int64_t comp_time_lzw = 0;
 	int64_t decomp_time_lzw = 0;
-
-	uint32_t mem_1_arith = 0;
-	uint32_t mem_2_arith = 0;
-	uint32_t mem_1_lzw = 0;
-	uint32_t mem_2_lzw = 0;
-	uint16_t  arith_compressed;
-	int8_t* lzw_compressed;
+	int64_t comp_time_delta = 0;
+	int64_t decomp_time_delta = 0;
+
+	mem_stats_t mem_stats;			//codec heap through memtrack, see memtrack.h
+	size_t mem_base = 0;
+	size_t heap_arith = 0;		//peak codec heap over compress and expand
+	size_t heap_lzw = 0;
+	profile_t profile_arith;		//per stage cycles, all zero unless built with CODEC_PROFILE
+	profile_t profile_lzw;
+	uint8_t* arith_compressed;
+	long arith_length = 0;
+	uint8_t* lzw_compressed;
+	long lzw_length = 0;
+	uint8_t* delta_compressed;
+	long delta_length = 0;
+	int32_t* values;
+	long n_values = 0;
+	char* decoded;
+	char* stripped;
+	char* text;
+	long decoded_length = 0;
 	int stream_length;
-	int i;
-	int j;
 	int z = 0;
 
+	if (BENCHMARK_MODE){
+		bench_config_t config;
+
+		BenchDefaults(&config);
+		BenchRun(&config);
+		return;
+	}
+
+	if (PIPELINE_MODE){
+		run_pipeline();
+		return;
+	}
+
 	stream_length = (N_SAMPLES != 0) ? N_SAMPLES * sample_length : 0;
-	lzw_compressed = malloc((stream_length)*sizeof(int8_t));
 	if (DEBUG) printf("-FREE HEAP: %i\n",esp_get_free_heap_size());
 
 	while(!stop){
 		if  (N_SAMPLES == 0)  stream_length += sample_length;
 
-		//Generate an input of STREAM_LENGTH bits to feed the algorithm
-		j = 0;
-
-		char input[stream_length];
-		for (i=0;i<stream_length;i++){
-			input[i] = (j != INTEGER_DIG) ? digits[esp_random() % (sizeof(digits))] : '.';	//condition ? (true):(false);
-			if(j == (INTEGER_DIG + DECIMAL_DIG)) j = 0;
-			else j++;
-		}
-		input[stream_length] = '\0';		//end of file
+		//Generate an input of STREAM_LENGTH bits to feed the algorithm.  The
+		//seed is fixed, so every iteration codes a prefix of the same samples
+		char* input = malloc(stream_length + 1);		//too big for the task stack
+		decoded = malloc(stream_length + 1);
+		stripped = malloc(stream_length + 1);
+		text = PRE_TRANSFORM ? stripped : input;
+		CorpusText(CORPUS_KIND, CORPUS_SEED, input, stream_length + 1,
+				stream_length/sample_length, INTEGER_DIG, DECIMAL_DIG);		//end of file included
 		if (DEBUG){
 			printf("[%i samples in buffer]-----------------------------------------\n",
 					stream_length/sample_length);
@@ -87,25 +217,40 @@ void app_main(){
 		}
 		/********************** ARITHMETIC CODING **********************/
 		if(CODING_TYPE == 0 || CODING_TYPE == 2){
-			mem_1_arith = esp_get_free_heap_size();
-			//arith_compressed = malloc(sizeof(uint16_t));
+			arith_compressed = malloc(arith_compress_bound(stream_length));
+			MemResetStats();
+			MemGetStats(&mem_stats);
+			mem_base = mem_stats.current;
+			ProfileReset();
 			time_1 = esp_timer_get_time();
-			compress(input, &arith_compressed);		//running compression algorithm
+			if (PRE_TRANSFORM) TransformStrip(input, stream_length, stripped, INTEGER_DIG, DECIMAL_DIG);
+			arith_length = compress(text, arith_compressed, arith_compress_bound(stream_length),
+					PRE_TRANSFORM ? sample_length - 1 : sample_length);		//running compression algorithm
+			if (arith_length < 0) stop = 1;
 			time_2 = esp_timer_get_time();
-			mem_2_arith = esp_get_free_heap_size();
 			if (DEBUG){
-				printf("-ARITH COMPRESS:\n%0X\nDecode:\n", arith_compressed);
+				printf("-ARITH COMPRESS:\n");
+				for (z=0;z<arith_length;z++) printf("%02X", arith_compressed[z]);
+				printf("\nDecode:\n");
 			}
 			time_3 = esp_timer_get_time();
-			expand(&arith_compressed, input);		//running decompression algorithm
+			decoded_length = expand(arith_compressed, arith_length, PRE_TRANSFORM ? stripped : decoded, stream_length + 1,
+					PRE_TRANSFORM ? sample_length - 1 : sample_length);		//running decompression algorithm
+			if (PRE_TRANSFORM && decoded_length >= 0)
+				decoded_length = TransformRestore(stripped, decoded_length, decoded, stream_length + 1, INTEGER_DIG, DECIMAL_DIG);
 			time_4 = esp_timer_get_time();
+			ProfileGet(&profile_arith);
+			MemGetStats(&mem_stats);
+			heap_arith = mem_stats.peak - mem_base;
+			free(arith_compressed);
 
-			if (DEBUG){
-				//print_distribution();
+			if (DEBUG && decoded_length >= 0){
+				printf("%s\n", decoded);
 			}
+			if (VERIFY_OUTPUT && check_output(input, decoded, decoded_length, stream_length) == -1) stop = 1;
 
 			if (stop) stream_length -= sample_length;
-			if(esp_get_free_heap_size() < stream_length) stop = 1;
+			if(esp_get_free_heap_size() < (uint32_t)stream_length) stop = 1;
 
 			//printf("%lld\n",time_4 - time_3);
 
@@ -114,38 +259,102 @@ void app_main(){
 
 		/***************************** LZW ****************************/
 		if(CODING_TYPE == 1 || CODING_TYPE == 2){
-			lzw_compressed = realloc(NULL, stream_length*sizeof(int8_t));
-			//lzw_compressed = malloc((stream_length)*sizeof(int8_t));
-			mem_1_lzw = esp_get_free_heap_size();
+			lzw_compressed = malloc(LZWEncodeBound(stream_length));
+			MemResetStats();
+			MemGetStats(&mem_stats);
+			mem_base = mem_stats.current;
+			ProfileReset();
 			time_5 = esp_timer_get_time();
 
-			LZWEncode(input, lzw_compressed);			//running compression algorithm
+			if (PRE_TRANSFORM) TransformStrip(input, stream_length, stripped, INTEGER_DIG, DECIMAL_DIG);
+			lzw_length = LZWEncode(text, lzw_compressed, LZWEncodeBound(stream_length));	//running compression algorithm
+			if (lzw_length < 0) stop = 1;
 
 			time_6 = esp_timer_get_time();
-			mem_2_lzw = esp_get_free_heap_size();
 
-			z = 0;
-			if(DEBUG) printf("LWZ COMPRESS:\n");
-			while(lzw_compressed[z] != -1){
-				if(DEBUG) printf("%0X", lzw_compressed[z]);
-				z++;
+			if(DEBUG){
+				printf("LWZ COMPRESS:\n");
+				for (z=0;z<lzw_length;z++) printf("%02X", lzw_compressed[z]);
 			}
 			if(DEBUG) printf("\nDecode:\n");
 			time_7 = esp_timer_get_time();
 
-			LZWDecode(lzw_compressed, input);		//running decompression algorithm
+			decoded_length = LZWDecode(lzw_compressed, lzw_length, PRE_TRANSFORM ? stripped : decoded, stream_length + 1);		//running decompression algorithm
+			if (PRE_TRANSFORM && decoded_length >= 0)
+				decoded_length = TransformRestore(stripped, decoded_length, decoded, stream_length + 1, INTEGER_DIG, DECIMAL_DIG);
 
 			free(lzw_compressed);
 			time_8 = esp_timer_get_time();
+			ProfileGet(&profile_lzw);
+			MemGetStats(&mem_stats);
+			heap_lzw = mem_stats.peak - mem_base;
+
+			if (DEBUG && decoded_length >= 0){
+				printf("%s\n", decoded);
+			}
+			if (VERIFY_OUTPUT && check_output(input, decoded, decoded_length, stream_length) == -1) stop = 1;
 
 			if (stop) stream_length -= sample_length;
-			if(esp_get_free_heap_size() < stream_length) stop = 1;
+			if(esp_get_free_heap_size() < (uint32_t)stream_length) stop = 1;
 
 			//printf("%lld\n",time_6 - time_5);
 
-			printf("%u\n", z*sizeof(int8_t));
+			printf("%ld\n", lzw_length);
+
+		}
+		/******************** DELTA + BIT PACKING ********************/
+		if(CODING_TYPE == 3){
+			values = malloc((stream_length/sample_length + 1)*sizeof(int32_t));
+			delta_compressed = malloc(DeltaCompressBound(stream_length/sample_length));
+			if (values == NULL || delta_compressed == NULL){
+				free(values);
+				free(delta_compressed);
+				stop = 1;
+				stream_length -= sample_length;
+				free(input);
+				free(decoded);
+				free(stripped);
+				break;
+			}
+			time_9 = esp_timer_get_time();
+
+			n_values = TransformParse(input, stream_length, values, INTEGER_DIG, DECIMAL_DIG);
+			delta_length = DeltaEncode(values, n_values, delta_compressed,
+					DeltaCompressBound(stream_length/sample_length));	//running compression algorithm
+			if (delta_length < 0) stop = 1;
+
+			time_10 = esp_timer_get_time();
+
+			if(DEBUG){
+				printf("DELTA COMPRESS:\n");
+				for (z=0;z<delta_length;z++) printf("%02X", delta_compressed[z]);
+				printf("\nDecode:\n");
+			}
+			time_11 = esp_timer_get_time();
+
+			n_values = DeltaDecode(delta_compressed, delta_length, values, stream_length/sample_length);	//running decompression algorithm
+			decoded_length = (n_values < 0) ? -1 :
+					TransformFormat(values, n_values, decoded, stream_length + 1, INTEGER_DIG, DECIMAL_DIG);
+
+			time_12 = esp_timer_get_time();
+			free(delta_compressed);
+			free(values);
 
+			if (DEBUG && decoded_length >= 0){
+				printf("%s\n", decoded);
+			}
+			if (VERIFY_OUTPUT && check_output(input, decoded, decoded_length, stream_length) == -1) stop = 1;
+
+			if (stop) stream_length -= sample_length;
+			if(esp_get_free_heap_size() < (uint32_t)stream_length) stop = 1;
+
+			printf("%ld\n", delta_length);
 		}
+		/**************************************************************/
+
+		free(input);
+		free(decoded);
+		free(stripped);
 		if (DEBUG) printf("FREE HEAP: %i\n",esp_get_free_heap_size());
 		/**************************************************************/
 		vTaskDelay(10 / portTICK_PERIOD_MS);
@@ -168,23 +377,40 @@ void app_main(){
 		}
 
 		printf("\n\t~ARITHMETIC CODING~\n"
-				"-> Stream size: %u, compressed size: %u, used heap: %u [bytes]\n",
-				stream_length*sizeof(char), sizeof(uint16_t), mem_1_arith - mem_2_arith);
+				"-> Stream size: %zu, compressed size: %u, peak codec heap: %zu [bytes]\n",
+				stream_length*sizeof(char), (unsigned int)arith_length, heap_arith);
 		printf("\n   EXECUTION TIME (us)\n");
 		printf("+------------------------+\n");
-		printf("|Compressing time: %lld   |\n", comp_time_arith);
+		printf("|Compressing time: %" PRId64 "   |\n", comp_time_arith);
 		printf("+------------------------+\n");
-		printf("|Decoding time: %lld     |\n", decomp_time_arith);
+		printf("|Decoding time: %" PRId64 "     |\n", decomp_time_arith);
 		printf("+------------------------+\n");
+		if (CODEC_PROFILE) ProfilePrint(&profile_arith);
 
 		printf("\n\t~LEMPEL-ZIV-WELCH~\n"
-				"-> Stream size: %u, compressed size: %u, used heap: %u [bytes]\n",
-				stream_length*sizeof(char), z*sizeof(int8_t), mem_1_lzw - mem_2_lzw);
+				"-> Stream size: %zu, compressed size: %u, peak codec heap: %zu [bytes]\n",
+				stream_length*sizeof(char), (unsigned int)lzw_length, heap_lzw);
+		printf("\n   EXECUTION TIME (us)\n");
+		printf("+------------------------+\n");
+		printf("|Compressing time: %" PRId64 "  |\n", comp_time_lzw);
+		printf("+------------------------+\n");
+		printf("|Decoding time: %" PRId64 "      |\n", decomp_time_lzw);
+		printf("+------------------------+\n");
+		if (CODEC_PROFILE) ProfilePrint(&profile_lzw);
+	}
+
+	if(CODING_TYPE == 3){
+		comp_time_delta = time_10 - time_9;		//get compression time
+		decomp_time_delta = time_12 - time_11;		//get decompression time
+
+		printf("\n\t~DELTA + BIT PACKING~\n"
+				"-> Stream size: %zu, compressed size: %u [bytes]\n",
+				stream_length*sizeof(char), (unsigned int)delta_length);
 		printf("\n   EXECUTION TIME (us)\n");
 		printf("+------------------------+\n");
-		printf("|Compressing time: %lld  |\n", comp_time_lzw);
+		printf("|Compressing time: %" PRId64 "   |\n", comp_time_delta);
 		printf("+------------------------+\n");
-		printf("|Decoding time: %lld      |\n", decomp_time_lzw);
+		printf("|Decoding time: %" PRId64 "     |\n", decomp_time_delta);
 		printf("+------------------------+\n");
 	}
 }
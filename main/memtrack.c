@@ -0,0 +1,235 @@
+/***************************************************************************
+*                       Memory Tracking Functions
+*
+*   File    : memtrack.c
+*   Purpose : Every block carries a small header with its size so a free
+*             can be counted.  The counters are atomic, so workers on
+*             several cores can allocate at once, and the peak is raised
+*             with a compare and swap.
+*
+*             Stack use is found by painting: MemStackMark fills a stretch
+*             of stack below the caller with a pattern, the code under
+*             test runs over it, and MemStackUsed counts how much of the
+*             pattern was overwritten, scanning up from the far end.  The
+*             figure is good to within the few dozen bytes of
+*             MemStackUsed's own frame.  Stacks grow down on both the
+*             ESP32 and the usual hosts.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "memtrack.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* keeps the block after the header aligned for any type */
+typedef union
+{
+    size_t size;
+    max_align_t align;
+} mem_header_t;
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define STACK_PAINT     0xA5
+#define STACK_GUARD     256     /* left alone below the marker's locals */
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static MEM_ALLOC backendAlloc = malloc;
+static MEM_FREE backendFree = free;
+
+static atomic_size_t current;
+static atomic_size_t peak;
+static atomic_ulong allocations;
+static atomic_ulong frees;
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : MemAlloc
+*   Description: This routine allocates size bytes from the backend and
+*                counts them.
+*   Parameters : size - bytes wanted
+*   Effects    : The counters are updated
+*   Returned   : The block, NULL if the backend is out of memory.
+***************************************************************************/
+void *MemAlloc(size_t size)
+{
+    mem_header_t *header;
+    size_t now;
+    size_t high;
+
+    if (size > (size_t)-1 - sizeof(mem_header_t))
+    {
+        return NULL;
+    }
+
+    header = backendAlloc(sizeof(mem_header_t) + size);
+
+    if (NULL == header)
+    {
+        return NULL;
+    }
+
+    header->size = size;
+    now = atomic_fetch_add(&current, size) + size;
+    high = atomic_load(&peak);
+
+    while ((now > high) &&
+        !atomic_compare_exchange_weak(&peak, &high, now))
+    {
+    }
+
+    atomic_fetch_add(&allocations, 1);
+
+    return header + 1;
+}
+
+/***************************************************************************
+*   Function   : MemCalloc
+*   Description: MemAlloc of count * size zeroed bytes.
+***************************************************************************/
+void *MemCalloc(size_t count, size_t size)
+{
+    void *block;
+
+    if ((size != 0) && (count > (size_t)-1 / size))
+    {
+        return NULL;
+    }
+
+    block = MemAlloc(count * size);
+
+    if (block != NULL)
+    {
+        memset(block, 0, count * size);
+    }
+
+    return block;
+}
+
+/***************************************************************************
+*   Function   : MemFree
+*   Description: Returns a block from MemAlloc or MemCalloc to the
+*                backend.  NULL is ignored, as by free.
+***************************************************************************/
+void MemFree(void *block)
+{
+    mem_header_t *header;
+
+    if (NULL == block)
+    {
+        return;
+    }
+
+    header = (mem_header_t *)block - 1;
+    atomic_fetch_sub(&current, header->size);
+    atomic_fetch_add(&frees, 1);
+    backendFree(header);
+}
+
+/***************************************************************************
+*   Function   : MemSetBackend
+*   Description: Routes allocations to another heap, for example
+*                external RAM through heap_caps_malloc on the ESP32.
+*   Parameters : alloc, release - the backend, NULL for malloc and free
+***************************************************************************/
+void MemSetBackend(MEM_ALLOC alloc, MEM_FREE release)
+{
+    backendAlloc = (alloc != NULL) ? alloc : malloc;
+    backendFree = (release != NULL) ? release : free;
+}
+
+/***************************************************************************
+*   Function   : MemGetStats / MemResetStats
+*   Description: Read the counters and start a new measurement.
+***************************************************************************/
+void MemGetStats(mem_stats_t *stats)
+{
+    stats->current = atomic_load(&current);
+    stats->peak = atomic_load(&peak);
+    stats->allocations = atomic_load(&allocations);
+    stats->frees = atomic_load(&frees);
+}
+
+void MemResetStats(void)
+{
+    atomic_store(&peak, atomic_load(&current));
+    atomic_store(&allocations, 0);
+    atomic_store(&frees, 0);
+}
+
+/***************************************************************************
+*   Function   : MemStackMark
+*   Description: This routine paints depth bytes of stack with a pattern.
+*                It is never inlined, so its frame is directly below the
+*                caller's, where the frames of whatever the caller calls
+*                next will be.  The paint starts STACK_GUARD bytes below
+*                a local, clear of this frame and any red zone, and is
+*                found from that local's address rather than from an
+*                object, so nothing refers to a dead frame afterwards.
+*                No call is made while painting, as its frame would land
+*                on the paint.
+*   Parameters : depth - bytes to paint, less than the free stack
+*   Effects    : The stack below the caller is painted
+*   Returned   : Where the paint is, for MemStackUsed
+***************************************************************************/
+#if defined(__GNUC__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+mem_stack_t MemStackMark(size_t depth)
+{
+    volatile uint8_t anchor = 0;
+    mem_stack_t mark;
+    size_t i;
+
+    mark.base = (volatile uint8_t *)((uintptr_t)&anchor - STACK_GUARD -
+        depth);
+    mark.depth = depth;
+
+    for (i = 0; i < depth; i++)
+    {
+        mark.base[i] = STACK_PAINT;
+    }
+
+    return mark;
+}
+
+/***************************************************************************
+*   Function   : MemStackUsed
+*   Description: This routine finds the deepest painted byte that was
+*                overwritten.
+*   Parameters : mark - what MemStackMark returned
+*   Effects    : None
+*   Returned   : Bytes of stack used below the caller.  Paint can only be
+*                reached through the guard, so the guard counts as used
+*                when any paint is.  depth + STACK_GUARD if all of the
+*                paint was used, so the stack may have gone deeper.
+***************************************************************************/
+size_t MemStackUsed(const mem_stack_t *mark)
+{
+    size_t untouched = 0;
+
+    while ((untouched < mark->depth) &&
+        (mark->base[untouched] == STACK_PAINT))
+    {
+        untouched++;
+    }
+
+    return (untouched < mark->depth) ?
+        mark->depth - untouched + STACK_GUARD : 0;
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+*                       Memory Tracking Functions
+*
+*   File    : memtrack.h
+*   Purpose : Provides prototypes for the allocator every codec module
+*             goes through and for measuring stack use.  The allocator
+*             passes requests on to a pluggable backend, malloc and free
+*             unless MemSetBackend is called, and counts the bytes in
+*             use, their peak and the number of calls, so transient
+*             working memory freed before a coder returns still shows.
+*
+***************************************************************************/
+
+#ifndef _MEMTRACK_H_
+#define _MEMTRACK_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef void *(*MEM_ALLOC)(size_t size);
+typedef void (*MEM_FREE)(void *block);
+
+typedef struct
+{
+    size_t current;             /* bytes allocated and not yet freed */
+    size_t peak;                /* most bytes in use since the reset */
+    unsigned long allocations;  /* successful allocations since the reset */
+    unsigned long frees;        /* frees since the reset */
+} mem_stats_t;
+
+typedef struct
+{
+    volatile uint8_t *base;     /* lowest painted byte */
+    size_t depth;               /* bytes painted */
+} mem_stack_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* tracked malloc, calloc and free */
+void *MemAlloc(size_t size);
+void *MemCalloc(size_t count, size_t size);
+void MemFree(void *block);
+
+/* route allocations to another heap, NULL for malloc and free.  Only
+ * change it while nothing allocated through the old one is live. */
+void MemSetBackend(MEM_ALLOC alloc, MEM_FREE release);
+
+/* read the counters */
+void MemGetStats(mem_stats_t *stats);
+
+/* restart the peak at the bytes in use now and zero the call counts */
+void MemResetStats(void);
+
+/* paint depth bytes of stack below the caller, call right before the
+ * code to measure, from the same function as MemStackUsed.  This goes
+ * outside what C promises: it assumes the stack grows down, that the
+ * depth bytes below the caller's frame are free stack of this thread,
+ * and that nothing else, such as an interrupt on the same stack, uses
+ * them before MemStackUsed.  The paint is written and read as volatile
+ * so none of it is optimized away. */
+mem_stack_t MemStackMark(size_t depth);
+
+/* bytes of the painted stack used since MemStackMark */
+size_t MemStackUsed(const mem_stack_t *mark);
+
+#endif  /* ndef _MEMTRACK_H_ */
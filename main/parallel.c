@@ -0,0 +1,322 @@
+/***************************************************************************
+*                   Parallel Block Compression Functions
+*
+*   File    : parallel.c
+*   Purpose : Runs ContainerEncode and ContainerDecode over chunks on a
+*             pool of worker threads.  Workers take the next chunk from
+*             a shared atomic counter, so a slow chunk does not hold up
+*             the others, and every chunk has its own place in the
+*             output, so the workers never write to the same bytes.  The
+*             calling thread works too, so threads = 1 runs serially.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include <stdatomic.h>
+#include "parallel.h"
+#include "container.h"
+#include "port.h"
+#include "memtrack.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    const uint8_t *in;          /* where the chunk's input starts */
+    long inLength;              /* bytes of input */
+    uint8_t *out;               /* where the chunk's output goes */
+    long outCapacity;           /* room for it */
+    long outLength;             /* bytes written, -1 on failure */
+} chunk_t;
+
+typedef struct
+{
+    int codec;                  /* compressing: codec, flags, format */
+    int flags;
+    int format;
+    int expand;                 /* decoding rather than coding */
+    chunk_t *chunks;
+    long chunkCount;
+    atomic_long next;           /* next chunk to hand out */
+} job_t;
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : Worker
+*   Description: Codes or decodes chunks until none are left.
+***************************************************************************/
+static void Worker(void *arg)
+{
+    job_t *job = arg;
+    chunk_t *chunk;
+    long i;
+
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->chunkCount)
+    {
+        chunk = &job->chunks[i];
+
+        if (job->expand)
+        {
+            chunk->outLength = ContainerDecode(chunk->in, chunk->inLength,
+                (char *)chunk->out, chunk->outCapacity);
+        }
+        else
+        {
+            chunk->outLength = ContainerEncode(job->codec, job->flags,
+                job->format, (const char *)chunk->in, chunk->inLength,
+                chunk->out, chunk->outCapacity);
+        }
+    }
+}
+
+/***************************************************************************
+*   Function   : RunJob
+*   Description: Starts threads - 1 workers, works on the calling thread
+*                as well and waits for them.  If a worker cannot be
+*                started the ones that were, and the caller, still finish
+*                every chunk.
+*   Returned   : 0 if every chunk succeeded, -1 otherwise.
+***************************************************************************/
+static int RunJob(job_t *job, int threads)
+{
+    port_thread_t workers[PARALLEL_MAX_THREADS];
+    int started;
+    long i;
+
+    if (threads <= 0)
+    {
+        threads = PortCoreCount();
+    }
+
+    if (threads > PARALLEL_MAX_THREADS)
+    {
+        threads = PARALLEL_MAX_THREADS;
+    }
+
+    if (threads > job->chunkCount)
+    {
+        threads = (job->chunkCount > 0) ? (int)job->chunkCount : 1;
+    }
+
+    atomic_init(&job->next, 0);
+
+    for (started = 0; started < threads - 1; started++)
+    {
+        if (PortThreadStart(&workers[started], "worker", Worker, job,
+            PORT_ANY_CORE) != 0)
+        {
+            break;
+        }
+    }
+
+    Worker(job);
+
+    while (started > 0)
+    {
+        PortThreadJoin(&workers[--started]);
+    }
+
+    for (i = 0; i < job->chunkCount; i++)
+    {
+        if (job->chunks[i].outLength < 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ParallelBound
+*   Description: Worst case size of a stream: every chunk stored with
+*                its block header.
+*   Parameters : length - number of chars of text
+*                format - CONTAINER_FORMAT() of the samples
+*                chunkSamples - samples per chunk
+*   Returned   : Bytes needed for the output buffer, -1 for bad arguments
+***************************************************************************/
+long ParallelBound(long length, int format, long chunkSamples)
+{
+    long chunkChars;
+
+    if ((format == 0) || (chunkSamples < 1) || (length < 0))
+    {
+        return -1;
+    }
+
+    chunkChars = chunkSamples * CONTAINER_SAMPLE_LENGTH(format);
+
+    return length +
+        ((length + chunkChars - 1) / chunkChars) * CONTAINER_HEADER_SIZE;
+}
+
+/***************************************************************************
+*   Function   : ParallelCompress
+*   Description: This routine cuts the samples into chunks, codes them on
+*                the workers and packs the blocks together.  Each chunk
+*                is coded into the slot it would take if it were stored,
+*                so the slots fit in ParallelBound() bytes, then the
+*                blocks are moved down over the unused ends of the slots.
+*   Parameters : codec - the CODEC_ id to code the chunks with
+*                flags - container flags, see ContainerEncode
+*                format - CONTAINER_FORMAT() of the samples
+*                text - the samples, a whole number of them
+*                length - number of chars of text
+*                chunkSamples - samples per chunk
+*                threads - number of workers, 0 for one per core
+*                out - where the stream goes
+*                capacity - size of out, ParallelBound() is enough
+*   Effects    : The stream is written to out
+*   Returned   : Size of the stream in bytes, -1 for failure.
+***************************************************************************/
+long ParallelCompress(int codec, int flags, int format, const char *text,
+    long length, long chunkSamples, int threads, uint8_t *out,
+    long capacity)
+{
+    job_t job;
+    long chunkChars;
+    long i;
+    long outLen;
+
+    if ((NULL == text) || (NULL == out) ||
+        (ParallelBound(length, format, chunkSamples) < 0) ||
+        (ParallelBound(length, format, chunkSamples) > capacity) ||
+        ((length % CONTAINER_SAMPLE_LENGTH(format)) != 0))
+    {
+        return -1;
+    }
+
+    chunkChars = chunkSamples * CONTAINER_SAMPLE_LENGTH(format);
+    job.codec = codec;
+    job.flags = flags;
+    job.format = format;
+    job.expand = 0;
+    job.chunkCount = (length + chunkChars - 1) / chunkChars;
+    job.chunks = MemAlloc(job.chunkCount * sizeof(chunk_t));
+
+    if ((NULL == job.chunks) && (job.chunkCount > 0))
+    {
+        return -1;
+    }
+
+    for (i = 0; i < job.chunkCount; i++)
+    {
+        job.chunks[i].in = (const uint8_t *)text + i * chunkChars;
+        job.chunks[i].inLength = (i + 1 < job.chunkCount) ?
+            chunkChars : length - i * chunkChars;
+        job.chunks[i].out = out + i * (chunkChars + CONTAINER_HEADER_SIZE);
+        job.chunks[i].outCapacity = ContainerBound(job.chunks[i].inLength);
+        job.chunks[i].outLength = -1;
+    }
+
+    outLen = -1;
+
+    if (RunJob(&job, threads) == 0)
+    {
+        outLen = 0;
+
+        for (i = 0; i < job.chunkCount; i++)
+        {
+            memmove(out + outLen, job.chunks[i].out, job.chunks[i].outLength);
+            outLen += job.chunks[i].outLength;
+        }
+    }
+
+    MemFree(job.chunks);
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : ParallelExpand
+*   Description: This routine walks the block headers to find where each
+*                block starts and where its text goes, then decodes the
+*                blocks on the workers straight into out.
+*   Parameters : in - the stream
+*                length - size of the stream in bytes
+*                out - where the text goes
+*                capacity - size of out in bytes
+*                threads - number of workers, 0 for one per core
+*   Effects    : The text is written to out, '\0' terminated when there
+*                is room.
+*   Returned   : Number of chars written, -1 if the stream is corrupt or
+*                the text does not fit.
+***************************************************************************/
+long ParallelExpand(const uint8_t *in, long length, char *out,
+    long capacity, int threads)
+{
+    block_header_t header;
+    job_t job;
+    long offset;
+    long outLen;
+    long i;
+
+    if ((NULL == in) || (NULL == out))
+    {
+        return -1;
+    }
+
+    /* count the blocks */
+    job.chunkCount = 0;
+
+    for (offset = 0; offset < length;
+        offset += CONTAINER_HEADER_SIZE + header.payloadLength)
+    {
+        if (ContainerParse(in + offset, length - offset, &header) != 0)
+        {
+            return -1;
+        }
+
+        job.chunkCount++;
+    }
+
+    job.expand = 1;
+    job.chunks = MemAlloc(job.chunkCount * sizeof(chunk_t));
+
+    if ((NULL == job.chunks) && (job.chunkCount > 0))
+    {
+        return -1;
+    }
+
+    /* give every block its place in the output */
+    outLen = 0;
+    offset = 0;
+
+    for (i = 0; i < job.chunkCount; i++)
+    {
+        ContainerParse(in + offset, length - offset, &header);
+
+        if (header.originalLength > (uint32_t)(capacity - outLen))
+        {
+            MemFree(job.chunks);
+            return -1;
+        }
+
+        job.chunks[i].in = in + offset;
+        job.chunks[i].inLength = CONTAINER_HEADER_SIZE + header.payloadLength;
+        job.chunks[i].out = (uint8_t *)out + outLen;
+        job.chunks[i].outCapacity = header.originalLength;
+        job.chunks[i].outLength = -1;
+        offset += job.chunks[i].inLength;
+        outLen += header.originalLength;
+    }
+
+    if (RunJob(&job, threads) != 0)
+    {
+        outLen = -1;
+    }
+    else if (outLen < capacity)
+    {
+        out[outLen] = '\0';
+    }
+
+    MemFree(job.chunks);
+    return outLen;
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+*                   Parallel Block Compression Functions
+*
+*   File    : parallel.h
+*   Purpose : Provides prototypes for coding large inputs on a pool of
+*             worker threads.  The samples are cut into chunks that are
+*             each coded with their own coder state, and the chunks'
+*             container blocks are concatenated into one stream in input
+*             order.  The blocks are self describing, so the stream is
+*             decoded by scanning the headers and handing the blocks out
+*             to the workers the same way.
+*
+***************************************************************************/
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define PARALLEL_MAX_THREADS    64
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* largest stream ParallelCompress can produce */
+long ParallelBound(long length, int format, long chunkSamples);
+
+/* code text on threads workers, 0 for one per core, returns the stream
+ * size or -1 */
+long ParallelCompress(int codec, int flags, int format, const char *text,
+    long length, long chunkSamples, int threads, uint8_t *out,
+    long capacity);
+
+/* decode a stream on threads workers, returns the chars written or -1 */
+long ParallelExpand(const uint8_t *in, long length, char *out,
+    long capacity, int threads);
+
+#endif  /* ndef _PARALLEL_H_ */
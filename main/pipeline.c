@@ -0,0 +1,313 @@
+/***************************************************************************
+*                     Sample Compression Pipeline
+*
+*   File    : pipeline.c
+*   Purpose : Runs the sampler, compressor and sink stages.  A stage
+*             that finds its ring full or empty yields rather than
+*             blocking, and any stage that fails raises a shared flag so
+*             the others stop waiting and return.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdatomic.h>
+#include "pipeline.h"
+#include "container.h"
+#include "ring.h"
+#include "port.h"
+#include "memtrack.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    const pipeline_config_t *config;
+    long blockChars;            /* chars of samples per block */
+    ring_t samples;             /* sampler -> compressor */
+    ring_t blocks;              /* compressor -> sink */
+    atomic_int failed;          /* a stage gave up */
+} pipeline_t;
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : Fail / Failed
+*   Description: Raise and test the shared failure flag.
+***************************************************************************/
+static void Fail(pipeline_t *pipe)
+{
+    atomic_store(&pipe->failed, 1);
+}
+
+static int Failed(pipeline_t *pipe)
+{
+    return atomic_load(&pipe->failed);
+}
+
+/***************************************************************************
+*   Function   : WriteAll
+*   Description: Writes length bytes to a ring, waiting for room.
+*   Returned   : 0 for success, -1 if the pipeline failed meanwhile.
+***************************************************************************/
+static int WriteAll(pipeline_t *pipe, ring_t *ring, const void *data,
+    long length)
+{
+    const uint8_t *p = data;
+    size_t written;
+
+    while (length > 0)
+    {
+        written = RingWrite(ring, p, length);
+
+        if (written == 0)
+        {
+            if (Failed(pipe))
+            {
+                return -1;
+            }
+
+            PortYield();
+        }
+
+        p += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadAll
+*   Description: Reads length bytes from a ring, waiting for them unless
+*                the ring finishes first.
+*   Returned   : Number of bytes read, short only at the end of the
+*                data, or -1 if the pipeline failed meanwhile.
+***************************************************************************/
+static long ReadAll(pipeline_t *pipe, ring_t *ring, void *data, long length)
+{
+    uint8_t *p = data;
+    long total = 0;
+    size_t got;
+
+    while (total < length)
+    {
+        got = RingRead(ring, p + total, length - total);
+
+        if (got == 0)
+        {
+            if (RingFinished(ring))
+            {
+                break;
+            }
+
+            if (Failed(pipe))
+            {
+                return -1;
+            }
+
+            PortYield();
+        }
+
+        total += got;
+    }
+
+    return total;
+}
+
+/***************************************************************************
+*   Function   : Sampler
+*   Description: Stage 1, moves the source's samples into the sample
+*                ring until the source ends.
+***************************************************************************/
+static void Sampler(void *arg)
+{
+    pipeline_t *pipe = arg;
+    const pipeline_config_t *config = pipe->config;
+    char *buffer;
+    long length;
+
+    buffer = MemAlloc(pipe->blockChars);
+
+    if (NULL == buffer)
+    {
+        Fail(pipe);
+    }
+    else
+    {
+        while (!Failed(pipe))
+        {
+            length = config->source(config->sourceOpaque, buffer,
+                pipe->blockChars);
+
+            if ((length <= 0) ||
+                (WriteAll(pipe, &pipe->samples, buffer, length) != 0))
+            {
+                break;
+            }
+        }
+    }
+
+    MemFree(buffer);
+    RingClose(&pipe->samples);
+}
+
+/***************************************************************************
+*   Function   : Compressor
+*   Description: Stage 2, codes each block of samples as a container
+*                block and moves it into the block ring.  The last block
+*                may be short.
+***************************************************************************/
+static void Compressor(void *arg)
+{
+    pipeline_t *pipe = arg;
+    const pipeline_config_t *config = pipe->config;
+    char *text;
+    uint8_t *block;
+    long length;
+    long blockLen;
+
+    text = MemAlloc(pipe->blockChars);
+    block = MemAlloc(ContainerBound(pipe->blockChars));
+
+    if ((NULL == text) || (NULL == block))
+    {
+        Fail(pipe);
+    }
+    else
+    {
+        while ((length = ReadAll(pipe, &pipe->samples, text,
+            pipe->blockChars)) > 0)
+        {
+            blockLen = ContainerEncode(config->codec, config->flags,
+                config->format, text, length, block,
+                ContainerBound(pipe->blockChars));
+
+            if ((blockLen < 0) ||
+                (WriteAll(pipe, &pipe->blocks, block, blockLen) != 0))
+            {
+                Fail(pipe);
+                break;
+            }
+        }
+
+        if (length < 0)
+        {
+            Fail(pipe);
+        }
+    }
+
+    MemFree(text);
+    MemFree(block);
+    RingClose(&pipe->blocks);
+}
+
+/***************************************************************************
+*   Function   : Sink
+*   Description: Stage 3, reassembles each block from the block ring,
+*                header first so the payload length is known, and hands
+*                it to the sink.
+***************************************************************************/
+static void Sink(pipeline_t *pipe)
+{
+    const pipeline_config_t *config = pipe->config;
+    block_header_t header;
+    uint8_t *block;
+    long length;
+
+    block = MemAlloc(ContainerBound(pipe->blockChars));
+
+    if (NULL == block)
+    {
+        Fail(pipe);
+        return;
+    }
+
+    while ((length = ReadAll(pipe, &pipe->blocks, block,
+        CONTAINER_HEADER_SIZE)) > 0)
+    {
+        if ((length != CONTAINER_HEADER_SIZE) ||
+            (ContainerParse(block, ContainerBound(pipe->blockChars),
+                &header) != 0) ||
+            (ReadAll(pipe, &pipe->blocks, block + CONTAINER_HEADER_SIZE,
+                header.payloadLength) != (long)header.payloadLength) ||
+            (config->sink(config->sinkOpaque, block,
+                CONTAINER_HEADER_SIZE + header.payloadLength) != 0))
+        {
+            Fail(pipe);
+            break;
+        }
+    }
+
+    if (length < 0)
+    {
+        Fail(pipe);
+    }
+
+    MemFree(block);
+}
+
+/***************************************************************************
+*   Function   : PipelineRun
+*   Description: This routine sets up the rings, starts the sampler and
+*                compressor threads, runs the sink on the caller's
+*                thread and waits for all three to finish.
+*   Parameters : config - the codec, block size, rings and callbacks
+*   Effects    : Every sample from the source is coded and shipped
+*   Returned   : 0 for success, -1 if any stage failed.
+***************************************************************************/
+int PipelineRun(const pipeline_config_t *config)
+{
+    pipeline_t pipe;
+    port_thread_t sampler;
+    port_thread_t compressor;
+    uint8_t *sampleBuffer;
+    uint8_t *blockBuffer;
+    int result = -1;
+
+    if ((NULL == config) || (config->format == 0) ||
+        (config->blockSamples < 1) ||
+        (NULL == config->source) || (NULL == config->sink))
+    {
+        return -1;
+    }
+
+    pipe.config = config;
+    pipe.blockChars = config->blockSamples *
+        CONTAINER_SAMPLE_LENGTH(config->format);
+    atomic_init(&pipe.failed, 0);
+
+    sampleBuffer = MemAlloc(config->ringSize);
+    blockBuffer = MemAlloc(config->ringSize);
+
+    if ((RingInit(&pipe.samples, sampleBuffer, config->ringSize) == 0) &&
+        (RingInit(&pipe.blocks, blockBuffer, config->ringSize) == 0))
+    {
+        if (PortThreadStart(&sampler, "sampler", Sampler, &pipe,
+            PIPELINE_SAMPLER_CORE) == 0)
+        {
+            if (PortThreadStart(&compressor, "compressor", Compressor, &pipe,
+                PIPELINE_COMPRESSOR_CORE) == 0)
+            {
+                Sink(&pipe);
+                PortThreadJoin(&compressor);
+            }
+            else
+            {
+                Fail(&pipe);
+            }
+
+            PortThreadJoin(&sampler);
+            result = Failed(&pipe) ? -1 : 0;
+        }
+    }
+
+    MemFree(sampleBuffer);
+    MemFree(blockBuffer);
+
+    return result;
+}
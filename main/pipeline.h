@@ -0,0 +1,64 @@
+/***************************************************************************
+*                     Sample Compression Pipeline
+*
+*   File    : pipeline.h
+*   Purpose : Provides the prototypes of the pipelined mode.  Three
+*             stages run at once, linked by lock free rings:
+*
+*               sampler     calls the source for sample text and feeds
+*                           the sample ring, on core 0
+*               compressor  drains the sample ring a block at a time and
+*                           feeds container blocks to the block ring,
+*                           pinned to core 1
+*               sink        hands each block from the block ring to the
+*                           sink, on the calling thread
+*
+*             so sampling, coding and shipping overlap instead of
+*             taking turns on one core.
+*
+***************************************************************************/
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define PIPELINE_SAMPLER_CORE       0
+#define PIPELINE_COMPRESSOR_CORE    1
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* fill up to max chars of samples, returns the count, 0 at the end */
+typedef long (*PIPELINE_SOURCE)(void *opaque, char *samples, long max);
+
+/* ship one container block, returns 0 or -1 to stop the pipeline */
+typedef int (*PIPELINE_SINK)(void *opaque, const uint8_t *block,
+    long length);
+
+typedef struct
+{
+    int codec;                  /* CODEC_ id for the blocks */
+    int flags;                  /* container flags */
+    int format;                 /* CONTAINER_FORMAT() of the samples */
+    long blockSamples;          /* samples per block */
+    long ringSize;              /* bytes per ring, a power of 2 */
+    PIPELINE_SOURCE source;
+    void *sourceOpaque;
+    PIPELINE_SINK sink;
+    void *sinkOpaque;
+} pipeline_config_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* run the pipeline until the source ends, returns 0 or -1 */
+int PipelineRun(const pipeline_config_t *config);
+
+#endif  /* ndef _PIPELINE_H_ */
@@ -0,0 +1,181 @@
+/***************************************************************************
+*                          Platform Port Layer
+*
+*   File    : port.c
+*   Purpose : ESP-IDF and host versions of the port services.
+*             FreeRTOS tasks cannot be joined, so each one gives a
+*             semaphore as it finishes and deletes itself.  A host has
+*             no fixed heap, so the free heap it reports is what is
+*             left of PORT_HOST_HEAP after the bytes malloc has handed
+*             out, which keeps the used heap figures comparable.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include "port.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_system.h"
+#include "esp_timer.h"
+#else
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#endif
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+#ifdef ESP_PLATFORM
+
+static void TaskEntry(void *arg)
+{
+    port_thread_t *thread = arg;
+
+    thread->entry(thread->arg);
+    xSemaphoreGive(thread->done);
+    vTaskDelete(NULL);
+}
+
+int PortThreadStart(port_thread_t *thread, const char *name,
+    PORT_ENTRY entry, void *arg, int core)
+{
+    BaseType_t created;
+
+    thread->entry = entry;
+    thread->arg = arg;
+    thread->done = xSemaphoreCreateBinary();
+
+    if (NULL == thread->done)
+    {
+        return -1;
+    }
+
+    created = xTaskCreatePinnedToCore(TaskEntry, name, PORT_STACK_SIZE,
+        thread, tskIDLE_PRIORITY + 1, &thread->task,
+        (core == PORT_ANY_CORE) ? tskNO_AFFINITY : core);
+
+    if (created != pdPASS)
+    {
+        vSemaphoreDelete(thread->done);
+        return -1;
+    }
+
+    return 0;
+}
+
+void PortThreadJoin(port_thread_t *thread)
+{
+    xSemaphoreTake(thread->done, portMAX_DELAY);
+    vSemaphoreDelete(thread->done);
+}
+
+void PortYield(void)
+{
+    /* a bare taskYIELD never lets lower priority tasks, the idle task
+     * and its watchdog feed included, run */
+    vTaskDelay(1);
+}
+
+int PortCoreCount(void)
+{
+    return portNUM_PROCESSORS;
+}
+
+int64_t PortTimeUs(void)
+{
+    return esp_timer_get_time();
+}
+
+uint32_t PortRandom(void)
+{
+    return esp_random();
+}
+
+uint32_t PortFreeHeap(void)
+{
+    return esp_get_free_heap_size();
+}
+
+#else
+
+static void *ThreadEntry(void *arg)
+{
+    port_thread_t *thread = arg;
+
+    thread->entry(thread->arg);
+    return NULL;
+}
+
+int PortThreadStart(port_thread_t *thread, const char *name,
+    PORT_ENTRY entry, void *arg, int core)
+{
+    (void)name;
+    (void)core;     /* the host scheduler spreads the threads itself */
+
+    thread->entry = entry;
+    thread->arg = arg;
+
+    return (pthread_create(&thread->thread, NULL, ThreadEntry, thread) == 0) ?
+        0 : -1;
+}
+
+void PortThreadJoin(port_thread_t *thread)
+{
+    pthread_join(thread->thread, NULL);
+}
+
+void PortYield(void)
+{
+    sched_yield();
+}
+
+int PortCoreCount(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (cores > 0) ? (int)cores : 1;
+}
+
+int64_t PortTimeUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint32_t PortRandom(void)
+{
+    /* rand() may give as few as 15 bits */
+    return ((uint32_t)rand() << 30) ^ ((uint32_t)rand() << 15) ^
+        (uint32_t)rand();
+}
+
+uint32_t PortFreeHeap(void)
+{
+    size_t used = 0;
+
+    /* big blocks are mapped rather than taken from the arena */
+#if defined(__GLIBC__) && \
+    ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+    struct mallinfo2 info = mallinfo2();
+
+    used = info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+
+    used = (unsigned int)info.uordblks + (unsigned int)info.hblkhd;
+#endif
+
+    return (used < PORT_HOST_HEAP) ? (uint32_t)(PORT_HOST_HEAP - used) : 0;
+}
+
+#endif
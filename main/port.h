@@ -0,0 +1,80 @@
+/***************************************************************************
+*                          Platform Port Layer
+*
+*   File    : port.h
+*   Purpose : Provides the few operating system services the pipeline
+*             and the worker pool need, and the timer, random number and
+*             heap figures the benchmarks read, so they build unchanged
+*             against FreeRTOS and ESP-IDF on the ESP32 and against
+*             pthreads and libc on a host.  ESP_PLATFORM is defined by
+*             the ESP-IDF build.
+*
+***************************************************************************/
+
+#ifndef _PORT_H_
+#define _PORT_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#endif
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define PORT_ANY_CORE       -1      /* let the scheduler place the thread */
+#define PORT_STACK_SIZE     8192    /* bytes, enough for the coders */
+#define PORT_HOST_HEAP      (320 * 1024)    /* heap the host pretends to */
+                                            /* have, about an ESP32's    */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef void (*PORT_ENTRY)(void *arg);
+
+typedef struct
+{
+    PORT_ENTRY entry;           /* function the thread runs */
+    void *arg;                  /* its argument */
+#ifdef ESP_PLATFORM
+    TaskHandle_t task;
+    SemaphoreHandle_t done;     /* given when entry returns */
+#else
+    pthread_t thread;
+#endif
+} port_thread_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* start entry(arg), on core if not PORT_ANY_CORE, returns 0 or -1 */
+int PortThreadStart(port_thread_t *thread, const char *name,
+    PORT_ENTRY entry, void *arg, int core);
+
+/* wait for a started thread to return */
+void PortThreadJoin(port_thread_t *thread);
+
+/* give up the processor while waiting on another thread */
+void PortYield(void);
+
+/* number of cores work can be spread over */
+int PortCoreCount(void);
+
+/* microseconds from a monotonic clock */
+int64_t PortTimeUs(void);
+
+/* 32 random bits, not for anything that has to be repeatable */
+uint32_t PortRandom(void);
+
+/* bytes of heap still free */
+uint32_t PortFreeHeap(void);
+
+#endif  /* ndef _PORT_H_ */
@@ -0,0 +1,105 @@
+/***************************************************************************
+*                       Hot Path Stage Profiling
+*
+*   File    : profile.c
+*   Purpose : Holds the per thread counters the PROFILE_ macros update,
+*             and reads and prints them.  Everything here still builds
+*             with CODEC_PROFILE off, so callers need no #if of their
+*             own; the counters then simply stay zero.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "profile.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+static const char *stageNames[PROFILE_STAGES] =
+    {"model", "rescale", "renorm", "underflow", "decode", "dict"};
+
+static const char *eventNames[PROFILE_EVENTS] =
+    {"bits_out", "underflows", "probes", "codes", "depth", "max_depth"};
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+#if CODEC_PROFILE
+_Thread_local profile_t profileCounters;
+#endif
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : ProfileReset / ProfileGet
+*   Description: Zero and read the calling thread's counters.
+***************************************************************************/
+void ProfileReset(void)
+{
+#if CODEC_PROFILE
+    memset(&profileCounters, 0, sizeof(profile_t));
+#endif
+}
+
+void ProfileGet(profile_t *profile)
+{
+#if CODEC_PROFILE
+    *profile = profileCounters;
+#else
+    memset(profile, 0, sizeof(profile_t));
+#endif
+}
+
+/***************************************************************************
+*   Function   : ProfilePrint
+*   Description: Prints one line per stage that ran, with its share of
+*                the cycles of the stages that are not nested in another,
+*                then the events.
+***************************************************************************/
+void ProfilePrint(const profile_t *profile)
+{
+    uint64_t total;
+    int i;
+
+    total = 0;
+
+    for (i = 0; i < PROFILE_STAGES; i++)
+    {
+        if (i != PROFILE_UNDERFLOW)
+        {
+            total += profile->cycles[i];
+        }
+    }
+
+    printf("%-10s %14s %12s %10s %6s\n", "stage", "cycles", "calls",
+        "per_call", "share");
+
+    for (i = 0; i < PROFILE_STAGES; i++)
+    {
+        if (profile->calls[i] == 0)
+        {
+            continue;
+        }
+
+        printf("%-10s %14llu %12llu %10.1f %5.1f%%\n", stageNames[i],
+            (unsigned long long)profile->cycles[i],
+            (unsigned long long)profile->calls[i],
+            (double)profile->cycles[i] / profile->calls[i],
+            (total > 0) ? (100.0 * profile->cycles[i]) / total : 0.0);
+    }
+
+    for (i = 0; i < PROFILE_EVENTS; i++)
+    {
+        if (profile->events[i] != 0)
+        {
+            printf("%-10s %14llu\n", eventNames[i],
+                (unsigned long long)profile->events[i]);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+*                       Hot Path Stage Profiling
+*
+*   File    : profile.h
+*   Purpose : Provides the cycle and event counters the coders update in
+*             their inner loops.  Build with CODEC_PROFILE=1 to turn them
+*             on; otherwise the macros expand to nothing and the coders
+*             compile exactly as without them.
+*
+*             Cycles come from the CCOUNT register on the ESP32, from
+*             rdtsc on x86 hosts and from the monotonic clock in ns on
+*             other hosts.  Reading the counter costs a few dozen cycles
+*             on a host, so stages only a handful of instructions long
+*             are inflated: compare them run to run, not in absolute
+*             terms.  The counters are per thread.
+*
+***************************************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+#ifndef CODEC_PROFILE
+#define CODEC_PROFILE 0
+#endif
+
+#if CODEC_PROFILE
+#if defined(ESP_PLATFORM)
+#include "xtensa/hal.h"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/* timed stages, a nested stage is counted in its parent too */
+#define PROFILE_MODEL       0   /* model lookup and update, both ways */
+#define PROFILE_RESCALE     1   /* encoder range update */
+#define PROFILE_RENORM      2   /* encoder renormalization */
+#define PROFILE_UNDERFLOW   3   /* pending underflow bits, in RENORM */
+#define PROFILE_DECODE      4   /* decoder range update and renorm */
+#define PROFILE_DICT        5   /* LZW dictionary lookup */
+#define PROFILE_STAGES      6
+
+/* counted events */
+#define PROFILE_BITS_OUT    0   /* bits the arithmetic encoder emitted */
+#define PROFILE_UNDERFLOWS  1   /* underflow bits pended */
+#define PROFILE_PROBES      2   /* LZW hash slots examined */
+#define PROFILE_CODES       3   /* LZW codes written */
+#define PROFILE_DEPTH       4   /* LZW chars matched by those codes */
+#define PROFILE_MAX_DEPTH   5   /* LZW longest match */
+#define PROFILE_EVENTS      6
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+#ifdef ESP_PLATFORM
+typedef uint32_t profile_tick_t;    /* CCOUNT is 32 bits and wraps */
+#else
+typedef uint64_t profile_tick_t;
+#endif
+
+typedef struct
+{
+    uint64_t cycles[PROFILE_STAGES];
+    uint64_t calls[PROFILE_STAGES];
+    uint64_t events[PROFILE_EVENTS];
+} profile_t;
+
+/***************************************************************************
+*                                  MACROS
+***************************************************************************/
+#if CODEC_PROFILE
+
+extern _Thread_local profile_t profileCounters;
+
+static inline profile_tick_t ProfileNow(void)
+{
+#if defined(ESP_PLATFORM)
+    return xthal_get_ccount();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + now.tv_nsec;
+#endif
+}
+
+#define PROFILE_START(t)    profile_tick_t t = ProfileNow()
+#define PROFILE_STOP(stage, t) \
+    do { \
+        profileCounters.cycles[stage] += (profile_tick_t)(ProfileNow() - (t)); \
+        profileCounters.calls[stage]++; \
+    } while (0)
+#define PROFILE_COUNT(event, n) \
+    (profileCounters.events[event] += (n))
+#define PROFILE_MAX(event, n) \
+    do { \
+        if ((uint64_t)(n) > profileCounters.events[event]) \
+            profileCounters.events[event] = (n); \
+    } while (0)
+
+#else
+
+#define PROFILE_START(t)
+#define PROFILE_STOP(stage, t)
+#define PROFILE_COUNT(event, n)
+#define PROFILE_MAX(event, n)
+
+#endif
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* zero the calling thread's counters */
+void ProfileReset(void);
+
+/* copy out the calling thread's counters, all zero when compiled out */
+void ProfileGet(profile_t *profile);
+
+/* print a per stage breakdown with cycles per call */
+void ProfilePrint(const profile_t *profile);
+
+#endif  /* ndef _PROFILE_H_ */
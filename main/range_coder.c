@@ -0,0 +1,127 @@
+/*
+ * range_coder.c
+ *
+ * This file contains a byte oriented range coder in the style of the
+ * one used by LZMA.  The encoder narrows a 32-bit range for every
+ * symbol and ships out the top byte of low whenever the range drops
+ * below 2^24.  The top byte is held back in a cache until it is
+ * known that no carry can reach it any more.
+ *
+ * Compared to the bit-at-a-time coder this costs one division and a
+ * couple of multiplies per symbol, and at most one byte out per
+ * renormalization step instead of a function call per bit.
+ */
+
+#include "range_coder.h"
+#include "profile.h"
+
+/*
+ * Ships out the top byte of the low register.  If the byte could
+ * still be changed by a carry it is only counted; once the carry is
+ * resolved, the cached byte and every pending 0xff are written.
+ */
+static void shift_low( RANGE_CODER *rc, BIT_STREAM *bs )
+{
+    uint8_t carry;
+
+    if ( (uint32_t) rc->low < 0xff000000UL || ( rc->low >> 32 ) != 0 )
+    {
+        carry = (uint8_t) ( rc->low >> 32 );
+        output_byte( bs, (uint8_t) ( rc->cache + carry ) );
+        while ( --rc->cache_size != 0 )
+            output_byte( bs, (uint8_t) ( 0xff + carry ) );
+        rc->cache = (uint8_t) ( rc->low >> 24 );
+    }
+    rc->cache_size++;
+    rc->low = ( rc->low & 0x00ffffffUL ) << 8;
+}
+
+void range_encoder_init( RANGE_CODER *rc )
+{
+    rc->low = 0;
+    rc->range = 0xffffffffUL;
+    rc->cache = 0;
+    rc->cache_size = 1;
+}
+
+/*
+ * The range is split into scale steps, and the symbol takes the
+ * steps from low_count to high_count.
+ */
+void range_encode_symbol( RANGE_CODER *rc, BIT_STREAM *bs, SYMBOL *s )
+{
+    uint32_t step;
+    PROFILE_START( start );
+
+    step = rc->range / s->scale;
+    rc->low += (uint64_t) step * s->low_count;
+    rc->range = step * ( s->high_count - s->low_count );
+    PROFILE_STOP( PROFILE_RESCALE, start );
+    PROFILE_START( renorm );
+    while ( rc->range < RANGE_TOP )
+    {
+        rc->range <<= 8;
+        shift_low( rc, bs );
+        PROFILE_COUNT( PROFILE_BITS_OUT, 8 );
+    }
+    PROFILE_STOP( PROFILE_RENORM, renorm );
+}
+
+/*
+ * Pushing five bytes through flushes the cache and all four bytes
+ * of low.
+ */
+void range_encoder_flush( RANGE_CODER *rc, BIT_STREAM *bs )
+{
+    int i;
+
+    for ( i = 0 ; i < 5 ; i++ )
+        shift_low( rc, bs );
+}
+
+/*
+ * The first byte written by the encoder is always the empty cache,
+ * so the decoder primes itself with five bytes.
+ */
+void range_decoder_init( RANGE_CODER *rc, BIT_STREAM *bs )
+{
+    int i;
+
+    rc->code = 0;
+    rc->range = 0xffffffffUL;
+    for ( i = 0 ; i < 5 ; i++ )
+        rc->code = ( rc->code << 8 ) | (uint32_t) input_byte( bs );
+}
+
+/*
+ * Returns the count the current code falls on.  The step is kept so
+ * that range_remove_symbol() does not need to divide again.  A code
+ * past the last symbol only comes from a corrupt or truncated stream,
+ * and is returned as s->scale, so the caller's count >= scale check
+ * fails it the way the 16-bit engine's does rather than decoding the
+ * last symbol.
+ */
+unsigned short int range_get_current_count( RANGE_CODER *rc, SYMBOL *s )
+{
+    uint32_t count;
+
+    rc->step = rc->range / s->scale;
+    count = rc->code / rc->step;
+    if ( count >= s->scale )
+        count = s->scale;
+    return( (unsigned short int) count );
+}
+
+void range_remove_symbol( RANGE_CODER *rc, BIT_STREAM *bs, SYMBOL *s )
+{
+    PROFILE_START( start );
+
+    rc->code -= rc->step * s->low_count;
+    rc->range = rc->step * ( s->high_count - s->low_count );
+    while ( rc->range < RANGE_TOP )
+    {
+        rc->code = ( rc->code << 8 ) | (uint32_t) input_byte( bs );
+        rc->range <<= 8;
+    }
+    PROFILE_STOP( PROFILE_DECODE, start );
+}
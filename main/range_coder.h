@@ -0,0 +1,41 @@
+/*
+ * range_coder.h
+ *
+ * This header file contains the declarations needed to use the
+ * 32-bit range coder.  It is an alternative engine to the 16-bit
+ * bit-at-a-time arithmetic coder: it takes the same SYMBOL counts
+ * from the same model, but keeps a 32-bit range and a 64-bit low
+ * register and renormalizes a whole byte at a time.  Carries out
+ * of the low register are propagated through a one byte cache plus
+ * a count of pending 0xff bytes, so there is no underflow tracking.
+ *
+ */
+
+#ifndef _RANGE_CODER_H_
+#define _RANGE_CODER_H_
+
+#include <stdint.h>
+#include "bitio.h"
+#include "arith_model.h"
+
+#define RANGE_TOP           ( 1UL << 24 )  /* Renormalization threshold */
+#define RANGE_MAXIMUM_SCALE 65535          /* Maximum allowed frequency */
+                                           /* count for this engine     */
+
+typedef struct {
+                uint64_t low;        /* Start of the range, plus carry  */
+                uint32_t range;      /* Width of the current range      */
+                uint32_t code;       /* Decoder: code value - low       */
+                uint32_t step;       /* Decoder: range / scale          */
+                uint8_t cache;       /* Last byte held back for a carry */
+                long cache_size;     /* cache plus pending 0xff bytes   */
+               } RANGE_CODER;
+
+void range_encoder_init( RANGE_CODER *rc );
+void range_encode_symbol( RANGE_CODER *rc, BIT_STREAM *bs, SYMBOL *s );
+void range_encoder_flush( RANGE_CODER *rc, BIT_STREAM *bs );
+void range_decoder_init( RANGE_CODER *rc, BIT_STREAM *bs );
+unsigned short int range_get_current_count( RANGE_CODER *rc, SYMBOL *s );
+void range_remove_symbol( RANGE_CODER *rc, BIT_STREAM *bs, SYMBOL *s );
+
+#endif  /* ndef _RANGE_CODER_H_ */
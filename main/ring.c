@@ -0,0 +1,148 @@
+/***************************************************************************
+*                   Single Producer Single Consumer Ring
+*
+*   File    : ring.c
+*   Purpose : The head and tail count bytes forever and are masked only
+*             when indexing, so a full ring and an empty one never look
+*             the same.  A side's own index is read relaxed, the other
+*             side's with acquire, and its own is published with release
+*             after the bytes are copied, so the reader never sees the
+*             index move before the data.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include "ring.h"
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : RingInit
+*   Description: Sets up an empty, open ring over a caller's buffer.
+*   Parameters : ring - the ring
+*                buffer - storage for the ring
+*                size - bytes of buffer, a power of 2
+*   Returned   : 0 for success, -1 if size is not a power of 2.
+***************************************************************************/
+int RingInit(ring_t *ring, uint8_t *buffer, size_t size)
+{
+    if ((NULL == buffer) || (size == 0) || ((size & (size - 1)) != 0))
+    {
+        return -1;
+    }
+
+    ring->buffer = buffer;
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, 0);
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : RingWrite
+*   Description: This routine copies as much of data as there is room
+*                for into the ring, in at most two pieces when it wraps.
+*                Only the producer may call it.
+*   Parameters : ring - the ring
+*                data - bytes to write
+*                length - number of bytes in data
+*   Effects    : The bytes are made visible to the consumer
+*   Returned   : Number of bytes written, 0 if the ring is full.
+***************************************************************************/
+size_t RingWrite(ring_t *ring, const void *data, size_t length)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t room = ring->mask + 1 - (head - tail);
+    size_t start = head & ring->mask;
+    size_t first;
+
+    if (length > room)
+    {
+        length = room;
+    }
+
+    first = ring->mask + 1 - start;
+
+    if (first > length)
+    {
+        first = length;
+    }
+
+    memcpy(ring->buffer + start, data, first);
+    memcpy(ring->buffer, (const uint8_t *)data + first, length - first);
+    atomic_store_explicit(&ring->head, head + length, memory_order_release);
+
+    return length;
+}
+
+/***************************************************************************
+*   Function   : RingClose
+*   Description: Marks the end of the data.  Only the producer may call
+*                it, after its last RingWrite.
+***************************************************************************/
+void RingClose(ring_t *ring)
+{
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+}
+
+/***************************************************************************
+*   Function   : RingRead
+*   Description: This routine copies as many of the bytes in the ring as
+*                fit in data out of it.  Only the consumer may call it.
+*   Parameters : ring - the ring
+*                data - where the bytes go
+*                length - size of data in bytes
+*   Effects    : The space is handed back to the producer
+*   Returned   : Number of bytes read, 0 if the ring is empty.
+***************************************************************************/
+size_t RingRead(ring_t *ring, void *data, size_t length)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t start = tail & ring->mask;
+    size_t first;
+
+    if (length > head - tail)
+    {
+        length = head - tail;
+    }
+
+    first = ring->mask + 1 - start;
+
+    if (first > length)
+    {
+        first = length;
+    }
+
+    memcpy(data, ring->buffer + start, first);
+    memcpy((uint8_t *)data + first, ring->buffer, length - first);
+    atomic_store_explicit(&ring->tail, tail + length, memory_order_release);
+
+    return length;
+}
+
+/***************************************************************************
+*   Function   : RingFinished
+*   Description: Tells the consumer the producer has closed the ring and
+*                every byte has been read.  closed is checked before the
+*                head so a write just ahead of the close is not missed.
+*   Returned   : 1 if finished, 0 if more data may come.
+***************************************************************************/
+int RingFinished(ring_t *ring)
+{
+    if (!atomic_load_explicit(&ring->closed, memory_order_acquire))
+    {
+        return 0;
+    }
+
+    return atomic_load_explicit(&ring->head, memory_order_acquire) ==
+        atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+*                   Single Producer Single Consumer Ring
+*
+*   File    : ring.h
+*   Purpose : Provides a lock free byte ring for passing data between
+*             exactly one writing thread and one reading thread, such as
+*             two pipeline stages on different cores.  The head is only
+*             written by the producer and the tail only by the consumer,
+*             so no locks are needed, just ordered loads and stores.
+*
+***************************************************************************/
+
+#ifndef _RING_H_
+#define _RING_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct
+{
+    uint8_t *buffer;            /* storage, a power of 2 bytes */
+    size_t mask;                /* size of buffer - 1 */
+    atomic_size_t head;         /* bytes ever written */
+    atomic_size_t tail;         /* bytes ever read */
+    atomic_int closed;          /* the producer has finished */
+} ring_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* use size bytes of buffer, size must be a power of 2, returns 0 or -1 */
+int RingInit(ring_t *ring, uint8_t *buffer, size_t size);
+
+/* producer: copy in up to length bytes, returns the number copied */
+size_t RingWrite(ring_t *ring, const void *data, size_t length);
+
+/* producer: no more data will be written */
+void RingClose(ring_t *ring);
+
+/* consumer: copy out up to length bytes, returns the number copied */
+size_t RingRead(ring_t *ring, void *data, size_t length);
+
+/* consumer: 1 once the ring is closed and drained */
+int RingFinished(ring_t *ring);
+
+#endif  /* ndef _RING_H_ */
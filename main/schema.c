@@ -0,0 +1,45 @@
+/***************************************************************************
+*                        Sample Alphabet and Layout
+*
+*   File    : schema.c
+*   Purpose : The lookup tables generated from SCHEMA_ALPHABET.  They are
+*             const, so on the ESP32 they stay in flash.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include "schema.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#if (SCHEMA_SYMBOLS > 255)
+#error The alphabet cannot have more symbols than chars
+#endif
+
+/* The alphabet is checked as it is compiled.  A symbol outside 0 to
+ * SCHEMA_SYMBOLS - 1 overruns schemaChars, and a symbol or char used
+ * twice is a duplicate case label below.  With SCHEMA_SYMBOLS entries,
+ * no duplicates and none out of range, every symbol is used once. */
+static inline void SchemaCheckUnique(int value)
+{
+    switch (value)
+    {
+        SCHEMA_ALPHABET(SCHEMA_SYMBOL_CASE)
+        default:
+            break;
+    }
+
+    switch (value)
+    {
+        SCHEMA_ALPHABET(SCHEMA_CHAR_CASE)
+        default:
+            break;
+    }
+}
+
+const uint8_t schemaSymbols[256] = {SCHEMA_ALPHABET(SCHEMA_SYMBOL_ENTRY)};
+
+const char schemaChars[SCHEMA_SYMBOLS] = {SCHEMA_ALPHABET(SCHEMA_CHAR_ENTRY)};
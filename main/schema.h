@@ -0,0 +1,109 @@
+/***************************************************************************
+*                        Sample Alphabet and Layout
+*
+*   File    : schema.h
+*   Purpose : Declares, in one place, the chars the codecs code and the
+*             layout of a sample: an optional sign, SCHEMA_INTEGER_DIGITS
+*             digits, SCHEMA_SEPARATOR and SCHEMA_DECIMAL_DIGITS digits.
+*             A device profile overrides any of these with -D flags or
+*             by defining them before this file is included.  An
+*             overriding SCHEMA_ALPHABET numbers its symbols from 0 with
+*             no gaps; SCHEMA_SYMBOLS is counted from it.
+*
+*             The alphabet is an X-macro of (symbol, char) pairs.  The
+*             char to symbol table is built from it by the compiler as a
+*             256 entry direct lookup, so mapping a char is one load with
+*             no branching on its value.  Entries hold symbol + 1, so a
+*             char outside the alphabet reads as 0 and maps to -1.
+*
+***************************************************************************/
+
+#ifndef _SCHEMA_H_
+#define _SCHEMA_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#ifndef SCHEMA_INTEGER_DIGITS
+#define SCHEMA_INTEGER_DIGITS   2
+#endif
+
+#ifndef SCHEMA_DECIMAL_DIGITS
+#define SCHEMA_DECIMAL_DIGITS   2
+#endif
+
+#ifndef SCHEMA_SIGNED
+#define SCHEMA_SIGNED           0   /* 1 -> every sample starts '+' or '-' */
+#endif
+
+#ifndef SCHEMA_SEPARATOR
+#define SCHEMA_SEPARATOR        '.'
+#endif
+
+#ifndef SCHEMA_ALPHABET
+#define SCHEMA_DIGITS(X) \
+    X(0, '0') X(1, '1') X(2, '2') X(3, '3') X(4, '4') \
+    X(5, '5') X(6, '6') X(7, '7') X(8, '8') X(9, '9')
+#if SCHEMA_SIGNED
+#define SCHEMA_ALPHABET(X) \
+    SCHEMA_DIGITS(X) X(10, SCHEMA_SEPARATOR) X(11, '+') X(12, '-')
+#else
+#define SCHEMA_ALPHABET(X) \
+    SCHEMA_DIGITS(X) X(10, SCHEMA_SEPARATOR)
+#endif
+#endif
+
+/* the alphabet counted by the preprocessor, so the size of every table
+ * and model follows it and #if can check it */
+#define SCHEMA_COUNT_ENTRY(symbol, c)   + 1
+#define SCHEMA_ALPHABET_SIZE    (0 SCHEMA_ALPHABET(SCHEMA_COUNT_ENTRY))
+
+#ifndef SCHEMA_SYMBOLS
+#define SCHEMA_SYMBOLS          SCHEMA_ALPHABET_SIZE
+#elif (SCHEMA_SYMBOLS != SCHEMA_ALPHABET_SIZE)
+#error SCHEMA_SYMBOLS does not match the number of entries in SCHEMA_ALPHABET
+#endif
+
+/***************************************************************************
+*                                  MACROS
+***************************************************************************/
+/* chars in one sample of a format */
+#define SCHEMA_SAMPLE_CHARS(integerDigits, decimalDigits) \
+    (SCHEMA_SIGNED + (integerDigits) + 1 + (decimalDigits))
+
+#define SCHEMA_SAMPLE_LENGTH \
+    SCHEMA_SAMPLE_CHARS(SCHEMA_INTEGER_DIGITS, SCHEMA_DECIMAL_DIGITS)
+
+/* X-macro bodies for building tables from SCHEMA_ALPHABET */
+#define SCHEMA_SYMBOL_ENTRY(symbol, c)  [(unsigned char)(c)] = (symbol) + 1,
+#define SCHEMA_CHAR_ENTRY(symbol, c)    [(symbol)] = (c),
+#define SCHEMA_SYMBOL_CASE(symbol, c)   case (symbol):
+#define SCHEMA_CHAR_CASE(symbol, c)     case (unsigned char)(c):
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+extern const uint8_t schemaSymbols[256];        /* char -> symbol + 1 */
+extern const char schemaChars[SCHEMA_SYMBOLS];  /* symbol -> char */
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* symbol of a char, -1 if it is not in the alphabet */
+static inline int SchemaSymbol(char c)
+{
+    return (int)schemaSymbols[(unsigned char)c] - 1;
+}
+
+/* char of a symbol, which must be below SCHEMA_SYMBOLS */
+static inline char SchemaChar(int symbol)
+{
+    return schemaChars[symbol];
+}
+
+#endif  /* ndef _SCHEMA_H_ */
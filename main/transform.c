@@ -0,0 +1,261 @@
+/***************************************************************************
+*                     Fixed Point Sample Pre-Transform
+*
+*   File    : transform.c
+*   Purpose : Converts fixed format text samples to a denser form ahead
+*             of the entropy coders, and back again after decoding.
+*             All the routines write a '\0' after text output when there
+*             is room for it, so the result can go straight to a coder.
+*             The separator and the sign come from schema.h; a sign, if
+*             there is one, counts with the integer part.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <string.h>
+#include "transform.h"
+#include "schema.h"
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : TransformStrip
+*   Description: This routine copies the digits of every sample and drops
+*                the separator between the integer and decimal parts.
+*   Parameters : in - text samples
+*                length - number of chars in, a whole number of samples
+*                out - buffer for the digits, at least length chars
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : The digits are written to out
+*   Returned   : Number of chars written, -1 if in is not in the format.
+***************************************************************************/
+long TransformStrip(const char *in, long length, char *out,
+    int integerDigits, int decimalDigits)
+{
+    int sampleLen = SCHEMA_SAMPLE_CHARS(integerDigits, decimalDigits);
+    int lead = SCHEMA_SIGNED + integerDigits;
+    long outLen = 0;
+    long i;
+
+    if ((length % sampleLen) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < length; i += sampleLen)
+    {
+        if (in[i + lead] != SCHEMA_SEPARATOR)
+        {
+            return -1;
+        }
+
+        memcpy(out + outLen, in + i, lead);
+        outLen += lead;
+        memcpy(out + outLen, in + i + lead + 1, decimalDigits);
+        outLen += decimalDigits;
+    }
+
+    out[outLen] = '\0';
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : TransformRestore
+*   Description: This routine is the inverse of TransformStrip, it puts
+*                the separator back after the integer digits of every
+*                sample.
+*   Parameters : in - digits of the samples
+*                length - number of chars in, a whole number of samples
+*                out - buffer for the text samples
+*                capacity - size of out
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : The text samples are written to out
+*   Returned   : Number of chars written, -1 if they do not fit.
+***************************************************************************/
+long TransformRestore(const char *in, long length, char *out, long capacity,
+    int integerDigits, int decimalDigits)
+{
+    int digits = SCHEMA_SAMPLE_CHARS(integerDigits, decimalDigits) - 1;
+    int lead = SCHEMA_SIGNED + integerDigits;
+    long outLen = 0;
+    long i;
+
+    if (((length % digits) != 0) ||
+        ((length / digits) * (digits + 1) > capacity))
+    {
+        return -1;
+    }
+
+    for (i = 0; i < length; i += digits)
+    {
+        memcpy(out + outLen, in + i, lead);
+        outLen += lead;
+        out[outLen++] = SCHEMA_SEPARATOR;
+        memcpy(out + outLen, in + i + lead, decimalDigits);
+        outLen += decimalDigits;
+    }
+
+    if (outLen < capacity)
+    {
+        out[outLen] = '\0';
+    }
+
+    return outLen;
+}
+
+/***************************************************************************
+*   Function   : TransformParse
+*   Description: This routine converts each text sample to the integer
+*                made of all its digits, i.e. the sample scaled by
+*                10^decimalDigits, negated for a '-' sign.  A value has
+*                one zero, which TransformFormat writes as '+', so a '-'
+*                zero sample could not be written back as it was read
+*                and is refused rather than turned into a '+' one.
+*   Parameters : in - text samples
+*                length - number of chars in, a whole number of samples
+*                values - buffer for one value per sample
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : The values are written to values
+*   Returned   : Number of values, -1 if in is not in the format or has a
+*                '-' zero.
+***************************************************************************/
+long TransformParse(const char *in, long length, int32_t *values,
+    int integerDigits, int decimalDigits)
+{
+    int sampleLen = SCHEMA_SAMPLE_CHARS(integerDigits, decimalDigits);
+    int lead = SCHEMA_SIGNED + integerDigits;
+    const char *p;
+    int32_t value;
+    unsigned int digit;
+    long count = 0;
+    long i;
+    int j;
+
+    if ((length % sampleLen) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < length; i += sampleLen)
+    {
+        p = in + i;
+        value = 0;
+
+        if (SCHEMA_SIGNED && (p[0] != '+') && (p[0] != '-'))
+        {
+            return -1;
+        }
+
+        for (j = SCHEMA_SIGNED; j < sampleLen; j++)
+        {
+            if (j == lead)
+            {
+                if (p[j] != SCHEMA_SEPARATOR)
+                {
+                    return -1;
+                }
+                continue;
+            }
+
+            digit = (unsigned char)p[j] - '0';
+
+            if (digit > 9)
+            {
+                return -1;
+            }
+
+            value = value * 10 + digit;
+        }
+
+        if (SCHEMA_SIGNED && (p[0] == '-'))
+        {
+            if (value == 0)
+            {
+                return -1;
+            }
+
+            value = -value;
+        }
+
+        values[count++] = value;
+    }
+
+    return count;
+}
+
+/***************************************************************************
+*   Function   : TransformFormat
+*   Description: This routine is the inverse of TransformParse, it writes
+*                every value back out as a zero padded text sample.
+*                Negative values need a signed schema.
+*   Parameters : values - fixed point values
+*                count - number of values
+*                out - buffer for the text samples
+*                capacity - size of out
+*                integerDigits, decimalDigits - the sample format
+*   Effects    : The text samples are written to out
+*   Returned   : Number of chars written, -1 if they do not fit or a value
+*                is out of range for the format.
+***************************************************************************/
+long TransformFormat(const int32_t *values, long count, char *out,
+    long capacity, int integerDigits, int decimalDigits)
+{
+    int sampleLen = SCHEMA_SAMPLE_CHARS(integerDigits, decimalDigits);
+    int lead = SCHEMA_SIGNED + integerDigits;
+    uint32_t value;
+    long outLen;
+    long i;
+    int j;
+
+    if (count * sampleLen > capacity)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if ((values[i] < 0) && !SCHEMA_SIGNED)
+        {
+            return -1;
+        }
+
+        value = (values[i] < 0) ?
+            0U - (uint32_t)values[i] : (uint32_t)values[i];
+        out[i * sampleLen + lead] = SCHEMA_SEPARATOR;
+
+        if (SCHEMA_SIGNED)
+        {
+            out[i * sampleLen] = (values[i] < 0) ? '-' : '+';
+        }
+
+        /* digits are written from the least significant one back */
+        for (j = sampleLen - 1; j >= SCHEMA_SIGNED; j--)
+        {
+            if (j == lead)
+            {
+                continue;
+            }
+
+            out[i * sampleLen + j] = '0' + (value % 10);
+            value /= 10;
+        }
+
+        if (value != 0)
+        {
+            return -1;
+        }
+    }
+
+    outLen = count * sampleLen;
+
+    if (outLen < capacity)
+    {
+        out[outLen] = '\0';
+    }
+
+    return outLen;
+}
@@ -0,0 +1,45 @@
+/***************************************************************************
+*                     Fixed Point Sample Pre-Transform
+*
+*   File    : transform.h
+*   Purpose : Provides prototypes for the optional stage that runs ahead
+*             of the entropy coders.  Samples are fixed format text,
+*             integerDigits digits, a '.', then decimalDigits digits,
+*             after a '+' or '-' with a signed schema (see schema.h).
+*             Since the '.' is always in the same place it carries no
+*             information, so it can be dropped before coding and put
+*             back after decoding.  Samples can also be parsed into
+*             fixed point integers, 12.34 -> 1234, for the coders that
+*             work on numbers rather than text.
+*
+***************************************************************************/
+
+#ifndef _TRANSFORM_H_
+#define _TRANSFORM_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* drop the separators, returns the number of chars written or -1 */
+long TransformStrip(const char *in, long length, char *out,
+    int integerDigits, int decimalDigits);
+
+/* put the separators back, returns the number of chars written or -1 */
+long TransformRestore(const char *in, long length, char *out, long capacity,
+    int integerDigits, int decimalDigits);
+
+/* text samples to fixed point values, returns the count or -1, which
+ * includes a '-' zero sample, since it would come back as '+' */
+long TransformParse(const char *in, long length, int32_t *values,
+    int integerDigits, int decimalDigits);
+
+/* fixed point values to text samples, returns the chars written or -1 */
+long TransformFormat(const int32_t *values, long count, char *out,
+    long capacity, int integerDigits, int decimalDigits);
+
+#endif  /* ndef _TRANSFORM_H_ */
@@ -0,0 +1,62 @@
+/***************************************************************************
+*                     Round Trip Verification Functions
+*
+*   File    : verify.c
+*   Purpose : Compares a decoded buffer with the original input.  The
+*             decoders never look at the original, so this is the only
+*             place a round trip is checked and it can be left out of
+*             timed runs altogether.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "verify.h"
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : VerifyBuffers
+*   Description: This routine compares two buffers a machine word at a
+*                time, so the compiler can vectorize the loop, and only
+*                drops to bytes to locate a difference or for the tail.
+*   Parameters : a, b - the buffers to compare
+*                length - number of bytes to compare
+*   Effects    : None
+*   Returned   : Index of the first differing byte, -1 if they match.
+***************************************************************************/
+long VerifyBuffers(const void *a, const void *b, size_t length)
+{
+    const unsigned char *pa = a;
+    const unsigned char *pb = b;
+    uint64_t wa, wb;
+    size_t i = 0;
+
+    while (i + sizeof(uint64_t) <= length)
+    {
+        memcpy(&wa, pa + i, sizeof(wa));
+        memcpy(&wb, pb + i, sizeof(wb));
+
+        if (wa != wb)
+        {
+            break;
+        }
+
+        i += sizeof(uint64_t);
+    }
+
+    for (; i < length; i++)
+    {
+        if (pa[i] != pb[i])
+        {
+            return (long)i;
+        }
+    }
+
+    return -1;
+}
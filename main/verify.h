@@ -0,0 +1,24 @@
+/***************************************************************************
+*                     Round Trip Verification Functions
+*
+*   File    : verify.h
+*   Purpose : Provides a prototype for the optional compare step that
+*             checks decoded output against the original input.
+*
+***************************************************************************/
+
+#ifndef _VERIFY_H_
+#define _VERIFY_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stddef.h>
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* index of the first byte where a and b differ, -1 if they match */
+long VerifyBuffers(const void *a, const void *b, size_t length);
+
+#endif  /* ndef _VERIFY_H_ */